@@ -0,0 +1,150 @@
+// Microbenchmark of the color map conversion of single channel images.
+//
+// Compares the per-pixel jet functions (getColor32fFromJetColorMap, getColor32fFromJetColorMapClamp)
+// packed to 0xffRRGGBB, with the row conversions of ColorMapLut (float and uint16 inputs).
+// Results are written as JSON: time per frame (ms), throughput (MP/s) and the largest channel difference
+// between both paths.
+//
+// Usage: colormap_bench [--size N] [--iterations N]
+
+#include "../colorMapLut.hpp"
+#include "../jetColorMap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+std::uint8_t toByte(float v)
+{
+    v = v > 0.0f ? v : 0.0f;
+    v = v < 1.0f ? v : 1.0f;
+    return static_cast<std::uint8_t>(v * 255.0f + 0.5f);
+}
+
+std::uint32_t pack(const Color32f& c)
+{
+    return 0xff000000u | (std::uint32_t(toByte(c.r)) << 16) | (std::uint32_t(toByte(c.g)) << 8) | std::uint32_t(toByte(c.b));
+}
+
+int maxChannelDifference(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b)
+{
+    int maxDifference = 0;
+    for(std::size_t i = 0; i < a.size(); ++i)
+    {
+        for(int shift = 0; shift < 24; shift += 8)
+        {
+            const int difference = std::abs(int((a[i] >> shift) & 0xffu) - int((b[i] >> shift) & 0xffu));
+            maxDifference = std::max(maxDifference, difference);
+        }
+    }
+    return maxDifference;
+}
+
+/// best time (ms) of a conversion of the whole frame
+template <typename Conversion>
+double bestTime(int iterations, Conversion&& conversion)
+{
+    double best = std::numeric_limits<double>::max();
+    for(int i = 0; i < iterations; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        conversion();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+void printResult(const char* name, double timeMs, double megapixels, int maxDifference, bool last)
+{
+    std::printf("    {\"name\": \"%s\", \"time_ms\": %.3f, \"throughput_mps\": %.1f, \"max_channel_difference\": %d}%s\n",
+                name, timeMs, megapixels / (timeMs / 1000.0), maxDifference, last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int size = 4096;
+    int iterations = 10;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "Usage: colormap_bench [--size N] [--iterations N]\n");
+            return 1;
+        }
+    }
+    if(size <= 0 || iterations <= 0)
+        return 1;
+
+    // values slightly outside of [0, 1] and a few NaNs, like normalized depth maps
+    const std::size_t count = std::size_t(size) * size;
+    std::vector<float> values(count);
+    std::vector<std::uint16_t> ushortValues(count);
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const float v = float((i * 7919) % 10007) / 10006.0f * 1.1f - 0.05f;
+        values[i] = (i % 4099 == 0) ? std::numeric_limits<float>::quiet_NaN() : v;
+        ushortValues[i] = std::uint16_t(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f);
+    }
+    const double megapixels = double(count) / 1e6;
+
+    std::vector<std::uint32_t> reference(count);
+    std::vector<std::uint32_t> output(count);
+
+    std::printf("{\n  \"size\": %d,\n  \"iterations\": %d,\n  \"results\": [\n", size, iterations);
+
+    const double jetFunctionTime = bestTime(iterations, [&]() {
+        for(std::size_t i = 0; i < count; ++i)
+            reference[i] = pack(getColor32fFromJetColorMap(values[i]));
+    });
+    printResult("jet_function", jetFunctionTime, megapixels, 0, false);
+
+    const ColorMapLut& jet = ColorMapLut::jet();
+    const double jetLutTime = bestTime(iterations, [&]() {
+        for(int y = 0; y < size; ++y)
+            jet.convertRow(values.data() + std::size_t(y) * size, size, output.data() + std::size_t(y) * size);
+    });
+    printResult("jet_lut_float", jetLutTime, megapixels, maxChannelDifference(reference, output), false);
+
+    const double jetClampFunctionTime = bestTime(iterations, [&]() {
+        for(std::size_t i = 0; i < count; ++i)
+            reference[i] = pack(getColor32fFromJetColorMapClamp(values[i]));
+    });
+    printResult("jet_clamp_function", jetClampFunctionTime, megapixels, 0, false);
+
+    const ColorMapLut& jetClamp = ColorMapLut::jetClamp();
+    const double jetClampLutTime = bestTime(iterations, [&]() {
+        for(int y = 0; y < size; ++y)
+            jetClamp.convertRow(values.data() + std::size_t(y) * size, size, output.data() + std::size_t(y) * size);
+    });
+    printResult("jet_clamp_lut_float", jetClampLutTime, megapixels, maxChannelDifference(reference, output), false);
+
+    // uint16 inputs: previously converted to float one pixel at a time, then looked up
+    const double ushortFunctionTime = bestTime(iterations, [&]() {
+        for(std::size_t i = 0; i < count; ++i)
+            reference[i] = pack(getColor32fFromJetColorMapClamp(float(ushortValues[i]) / 65535.0f));
+    });
+    printResult("jet_clamp_function_uint16", ushortFunctionTime, megapixels, 0, false);
+
+    const double ushortLutTime = bestTime(iterations, [&]() {
+        for(int y = 0; y < size; ++y)
+            jetClamp.convertRow(ushortValues.data() + std::size_t(y) * size, size, output.data() + std::size_t(y) * size, 1.0f / 65535.0f);
+    });
+    printResult("jet_clamp_lut_uint16", ushortLutTime, megapixels, maxChannelDifference(reference, output), true);
+
+    std::printf("  ]\n}\n");
+    return 0;
+}
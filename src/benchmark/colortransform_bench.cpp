@@ -0,0 +1,143 @@
+// Microbenchmark and check of the color space conversion of RGBA float images.
+//
+// Compares the previous ImageBufAlgo::colorconvert of the whole image with the row conversions of
+// ColorTransform: the processor path (float outputs) and the lookup table path (8-bit outputs).
+// Inputs are premultiplied RGBA pixels with partial and zero alphas and colors out of [0, 1].
+// Results are written as JSON: time per frame (ms), throughput (MP/s) and the largest channel difference
+// with colorconvert after quantization to 8 bits. Exits with 2 if a difference is above 1.
+//
+// Usage: colortransform_bench [--size N] [--iterations N] [--from COLORSPACE]
+
+#include "../imageIOHandler/colorTransform.hpp"
+
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace oiio = OIIO;
+
+namespace {
+
+int toByte(float v)
+{
+    v = v > 0.0f ? v : 0.0f;
+    v = v < 1.0f ? v : 1.0f;
+    return int(v * 255.0f + 0.5f);
+}
+
+int maxChannelDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    int maxDifference = 0;
+    for(std::size_t i = 0; i < a.size(); ++i)
+        maxDifference = std::max(maxDifference, std::abs(toByte(a[i]) - toByte(b[i])));
+    return maxDifference;
+}
+
+/// best time (ms) of a conversion of the whole frame
+template <typename Conversion>
+double bestTime(int iterations, Conversion&& conversion)
+{
+    double best = std::numeric_limits<double>::max();
+    for(int i = 0; i < iterations; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        conversion();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+void printResult(const char* name, double timeMs, double megapixels, int maxDifference, bool last)
+{
+    std::printf("    {\"name\": \"%s\", \"time_ms\": %.3f, \"throughput_mps\": %.1f, \"max_channel_difference\": %d}%s\n",
+                name, timeMs, megapixels / (timeMs / 1000.0), maxDifference, last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int size = 2048;
+    int iterations = 5;
+    std::string from = "linear";
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--from") == 0 && i + 1 < argc)
+            from = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Usage: colortransform_bench [--size N] [--iterations N] [--from COLORSPACE]\n");
+            return 1;
+        }
+    }
+    if(size <= 0 || iterations <= 0)
+        return 1;
+
+    const std::shared_ptr<const ColorTransform> transform = ColorTransform::get(from, "sRGB");
+    if(!transform)
+        return 1;
+
+    // premultiplied RGBA: alphas 0, 0.25, 0.5, 1 and colors in [-0.1, 1.5] (HDR highlights)
+    const std::size_t count = std::size_t(size) * size;
+    const float alphas[] = {1.0f, 0.5f, 0.25f, 0.0f};
+    std::vector<float> input(count * 4);
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const float alpha = alphas[(i / 7) % 4];
+        for(int c = 0; c < 3; ++c)
+        {
+            const float v = float((i * 7919 + c * 104729) % 10007) / 10006.0f * 1.6f - 0.1f;
+            input[4 * i + c] = v * alpha;
+        }
+        input[4 * i + 3] = alpha;
+    }
+    const double megapixels = double(count) / 1e6;
+
+    const oiio::ImageSpec spec(size, size, 4, oiio::TypeDesc::FLOAT);
+    const oiio::ImageBuf inBuf(spec, input.data());
+    oiio::ImageBuf colorconvertBuf;
+    std::vector<float> reference(count * 4);
+    std::vector<float> output(count * 4);
+
+    std::printf("{\n  \"size\": %d,\n  \"iterations\": %d,\n  \"from\": \"%s\",\n  \"lut\": %s,\n  \"results\": [\n",
+                size, iterations, from.c_str(), transform->hasLut() ? "true" : "false");
+
+    const double colorconvertTime = bestTime(iterations, [&]() {
+        oiio::ImageBufAlgo::colorconvert(colorconvertBuf, inBuf, from, "sRGB");
+    });
+    colorconvertBuf.get_pixels(colorconvertBuf.roi(), oiio::TypeDesc::FLOAT, reference.data());
+    printResult("colorconvert", colorconvertTime, megapixels, 0, false);
+
+    const double processorTime = bestTime(iterations, [&]() {
+        output = input;
+        for(int y = 0; y < size; ++y)
+            transform->apply(output.data() + std::size_t(y) * size * 4, size, 4, false);
+    });
+    const int processorDifference = maxChannelDifference(reference, output);
+    printResult("processor_rows", processorTime, megapixels, processorDifference, false);
+
+    const double lutTime = bestTime(iterations, [&]() {
+        output = input;
+        for(int y = 0; y < size; ++y)
+            transform->apply(output.data() + std::size_t(y) * size * 4, size, 4, true);
+    });
+    const int lutDifference = maxChannelDifference(reference, output);
+    printResult("lut_rows", lutTime, megapixels, lutDifference, true);
+
+    std::printf("  ]\n}\n");
+    return (processorDifference > 1 || lutDifference > 1) ? 2 : 0;
+}
@@ -0,0 +1,717 @@
+// Benchmark of the QtOIIO decode paths.
+//
+// Synthetic images are generated for each pixel type (8/16-bit, half, float), channel count (1, 3, 4),
+// color space (linear, sRGB) and layout (scanline, tiled), then read through QImageReader, with and
+// without ScaledSize. Results are written as JSON: throughput (MP/s), latency percentiles and peak RSS.
+// With --concurrency N, each case is also read by 2, 4... N concurrent readers to measure the scaling
+// of the shared thread budget (--threads sets QTOIIO_THREADS).
+// With --mmap, each case is read with buffered reads and with memory-mapped files (QTOIIO_MMAP), combine with
+// --cold for the cold/warm page cache comparison.
+// Each image is also read through centered ClipRects of 1/8, 1/4 and 1/2 of its side, so that the cost of
+// region reads can be compared with the ROI size.
+// Scaled reads are compared to a full read resized by QImage::scaled (previous resize path of the plugin):
+// PSNR of the output, and time of the plugin resample stage (QTOIIO_TRACE) against the time of QImage::scaled.
+// Each image is also enlarged to twice its size (upscale), to check the filter of the enlargements.
+// The conversion of decoded pixels to 16-bit RGBA QImages is also measured in memory for each pixel type and
+// channel count: previous per-pixel getpixel loop against the row conversions (one get_pixels call per row).
+// The fallbacks of the scaled reads (embedded thumbnail path) are checked on one file each: format without
+// thumbnail (full decode), file that cannot be opened and truncated file (no image, no crash). The benchmark
+// exits with 2 if one of them fails.
+//
+// Usage: qtoiio_bench [--size N] [--iterations N] [--scaled N] [--dir DIR] [--output FILE] [--cold] [--cache]
+//                     [--concurrency N] [--threads N] [--mmap]
+
+#include "../imageIOHandler/rowConversion.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRgba64>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace oiio = OIIO;
+
+namespace {
+
+struct Options
+{
+    int size = 4096;
+    int iterations = 10;
+    int scaledSize = 512;
+    QString directory;
+    QString output;
+    bool cold = false;  // also measure reads with the file evicted from the page cache
+    bool cache = false; // keep the QtOIIO decoded-image cache enabled
+    int concurrency = 1; // maximum number of concurrent readers
+    int threads = 0;     // thread budget of the plugin (QTOIIO_THREADS), 0 to keep the default
+    bool mmap = false;   // also measure reads with memory-mapped files (QTOIIO_MMAP)
+};
+
+struct ImageCase
+{
+    QString name;
+    QString path;
+    oiio::TypeDesc type;
+    int nchannels;
+    bool linear;
+    bool tiled;
+};
+
+/// value in KB of a memory field of /proc/self/status ("VmRSS", "VmHWM"), -1 if unknown
+long procStatusKB(const QByteArray& field)
+{
+#ifdef __linux__
+    QFile status("/proc/self/status");
+    if(!status.open(QIODevice::ReadOnly))
+        return -1;
+    for(const QByteArray& line : status.readAll().split('\n'))
+    {
+        if(line.startsWith(field + ':'))
+            return line.mid(field.size() + 1).trimmed().split(' ').first().toLong();
+    }
+#else
+    Q_UNUSED(field);
+#endif
+    return -1;
+}
+
+/// reset the peak resident set size of the process (VmHWM), false if not supported
+bool resetPeakRSS()
+{
+#ifdef __linux__
+    // Linux >= 4.0: writing 5 to clear_refs resets the peak RSS
+    QFile clearRefs("/proc/self/clear_refs");
+    return clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5") == 1;
+#else
+    return false;
+#endif
+}
+
+/// peak resident set size of the process lifetime in KB, -1 if unknown
+long peakRSS()
+{
+#ifdef __linux__
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+#endif
+    return -1;
+}
+
+/// drop the pages of a file from the page cache (cold read)
+void evictFromPageCache(const QString& path)
+{
+#ifdef __linux__
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+    if(fd < 0)
+        return;
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+#else
+    Q_UNUSED(path);
+#endif
+}
+
+bool writeSyntheticImage(const ImageCase& imageCase, int size)
+{
+    std::unique_ptr<oiio::ImageOutput> out = oiio::ImageOutput::create(imageCase.path.toStdString());
+    if(!out)
+        return false;
+
+    oiio::ImageSpec spec(size, size, imageCase.nchannels, imageCase.type);
+    spec.attribute("oiio:ColorSpace", imageCase.linear ? "Linear" : "sRGB");
+    spec.attribute("compression", "zip");
+    if(imageCase.tiled)
+    {
+        spec.tile_width = 64;
+        spec.tile_height = 64;
+        spec.tile_depth = 1;
+    }
+    if(!out->open(imageCase.path.toStdString(), spec))
+        return false;
+
+    // smooth gradients with some noise, so that the compression has some work to do
+    std::vector<float> pixels(std::size_t(size) * size * imageCase.nchannels);
+    for(int y = 0; y < size; ++y)
+    {
+        for(int x = 0; x < size; ++x)
+        {
+            float* p = &pixels[(std::size_t(y) * size + x) * imageCase.nchannels];
+            for(int c = 0; c < imageCase.nchannels; ++c)
+            {
+                const float noise = float((x * 7919 + y * 104729 + c * 31) % 97) / 97.0f;
+                p[c] = 0.8f * (float(x + c * size / 3) / float(size)) * (float(y) / float(size)) + 0.2f * noise;
+            }
+        }
+    }
+    const bool success = out->write_image(oiio::TypeDesc::FLOAT, pixels.data());
+    return out->close() && success;
+}
+
+std::vector<ImageCase> generateImages(const QString& directory, int size)
+{
+    const oiio::TypeDesc types[] = {oiio::TypeDesc::UINT8, oiio::TypeDesc::UINT16, oiio::TypeDesc::HALF, oiio::TypeDesc::FLOAT};
+    std::vector<ImageCase> cases;
+    for(const oiio::TypeDesc& type : types)
+    {
+        for(int nchannels : {1, 3, 4})
+        {
+            for(bool linear : {true, false})
+            {
+                for(bool tiled : {false, true})
+                {
+                    ImageCase imageCase;
+                    imageCase.name = QString("%1_%2ch_%3_%4").arg(type.c_str()).arg(nchannels).arg(linear ? "linear" : "srgb").arg(tiled ? "tiled" : "scanline");
+                    // integer images in TIFF, floating point images in EXR
+                    const bool isFloat = type == oiio::TypeDesc::HALF || type == oiio::TypeDesc::FLOAT;
+                    imageCase.path = QDir(directory).filePath(imageCase.name + (isFloat ? ".exr" : ".tif"));
+                    imageCase.type = type;
+                    imageCase.nchannels = nchannels;
+                    imageCase.linear = linear;
+                    imageCase.tiled = tiled;
+                    if(writeSyntheticImage(imageCase, size))
+                        cases.push_back(imageCase);
+                    else
+                        qWarning() << "Cannot write" << imageCase.path << ":" << oiio::geterror().c_str();
+                }
+            }
+        }
+    }
+    return cases;
+}
+
+/// PSNR (in dB) between two images of the same size, on 16-bit RGBA values
+double psnr(const QImage& image, const QImage& reference)
+{
+    if(image.size() != reference.size() || image.isNull())
+        return 0.0;
+    const QImage a = image.convertToFormat(QImage::Format_RGBA64);
+    const QImage b = reference.convertToFormat(QImage::Format_RGBA64);
+    double squaredError = 0.0;
+    for(int y = 0; y < a.height(); ++y)
+    {
+        const quint16* rowA = reinterpret_cast<const quint16*>(a.constScanLine(y));
+        const quint16* rowB = reinterpret_cast<const quint16*>(b.constScanLine(y));
+        for(int i = 0; i < 4 * a.width(); ++i)
+        {
+            const double d = (double(rowA[i]) - double(rowB[i])) / 65535.0;
+            squaredError += d * d;
+        }
+    }
+    const double mse = squaredError / (4.0 * a.width() * a.height());
+    return mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : 999.0;
+}
+
+/// nearest-rank percentile
+double percentile(std::vector<double> values, double p)
+{
+    if(values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    const std::size_t rank = std::size_t(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+/// largest difference between the 16-bit channels of two images of the same size and format
+int maxChannelDifference(const QImage& a, const QImage& b)
+{
+    int maxDifference = 0;
+    for(int y = 0; y < a.height(); ++y)
+    {
+        const quint16* rowA = reinterpret_cast<const quint16*>(a.constScanLine(y));
+        const quint16* rowB = reinterpret_cast<const quint16*>(b.constScanLine(y));
+        for(int i = 0; i < 4 * a.width(); ++i)
+            maxDifference = std::max(maxDifference, std::abs(int(rowA[i]) - int(rowB[i])));
+    }
+    return maxDifference;
+}
+
+/**
+ * @brief Conversion of an in-memory image to a 16-bit RGBA QImage (no decode, no color conversion):
+ *        per-pixel getpixel loop (previous conversion) against the row conversions of the plugin.
+ *        Gray images are replicated to RGB in both paths.
+ */
+QJsonObject runConversionCase(oiio::TypeDesc type, int nchannels, const Options& options)
+{
+    const int size = options.size;
+    oiio::ImageBuf inBuf(oiio::ImageSpec(size, size, nchannels, type));
+    const float topLeft[] = {0.0f, 0.25f, 0.5f, 1.0f};
+    const float topRight[] = {1.0f, 0.5f, 0.0f, 0.75f};
+    const float bottomLeft[] = {0.5f, 1.0f, 0.25f, 0.5f};
+    const float bottomRight[] = {0.25f, 0.0f, 1.0f, 0.25f};
+    oiio::ImageBufAlgo::fill(inBuf, oiio::cspan<float>(topLeft, nchannels), oiio::cspan<float>(topRight, nchannels),
+                             oiio::cspan<float>(bottomLeft, nchannels), oiio::cspan<float>(bottomRight, nchannels));
+
+    QImage getpixelImage(size, size, QImage::Format_RGBA64);
+    QImage rowsImage(size, size, QImage::Format_RGBA64);
+    std::vector<double> getpixelTimes; // ms
+    std::vector<double> rowsTimes;     // ms
+    for(int i = 0; i < options.iterations; ++i)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for(int y = 0; y < size; ++y)
+        {
+            quint64* row = reinterpret_cast<quint64*>(getpixelImage.scanLine(y));
+            for(int x = 0; x < size; ++x)
+            {
+                float rgba[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+                inBuf.getpixel(x, y, rgba, 4);
+                if(nchannels == 1)
+                    rgba[1] = rgba[2] = rgba[0];
+                row[x] = quint64(QRgba64::fromRgba64(floatToUShort(rgba[0]), floatToUShort(rgba[1]), floatToUShort(rgba[2]), floatToUShort(rgba[3])));
+            }
+        }
+        getpixelTimes.push_back(timer.nsecsElapsed() / 1e6);
+
+        timer.restart();
+        const oiio::ROI roi = inBuf.roi();
+        const bool isUShort = type == oiio::TypeDesc::UINT16 && nchannels != 1;
+        std::vector<float> floatRow(isUShort ? 0 : std::size_t(size) * nchannels);
+        std::vector<float> grayRow(nchannels == 1 ? std::size_t(size) * 3 : 0);
+        for(int y = 0; y < size; ++y)
+        {
+            quint16* dst = reinterpret_cast<quint16*>(rowsImage.scanLine(y));
+            const oiio::ROI rowROI(roi.xbegin, roi.xend, roi.ybegin + y, roi.ybegin + y + 1, 0, 1, 0, nchannels);
+            if(isUShort)
+            {
+                inBuf.get_pixels(rowROI, oiio::TypeDesc::UINT16, dst, 4 * sizeof(quint16));
+                if(nchannels == 3)
+                    fillRowAlphaRgba64(dst, size);
+                continue;
+            }
+            inBuf.get_pixels(rowROI, oiio::TypeDesc::FLOAT, floatRow.data());
+            if(nchannels == 1)
+            {
+                for(int x = 0; x < size; ++x)
+                    grayRow[3 * x + 0] = grayRow[3 * x + 1] = grayRow[3 * x + 2] = floatRow[x];
+                convertRowFloatToRgba64(grayRow.data(), 3, dst, size);
+            }
+            else
+            {
+                convertRowFloatToRgba64(floatRow.data(), nchannels, dst, size);
+            }
+        }
+        rowsTimes.push_back(timer.nsecsElapsed() / 1e6);
+    }
+
+    const double megapixels = double(size) * size / 1e6;
+    const double getpixelTime = percentile(getpixelTimes, 50.0);
+    const double rowsTime = percentile(rowsTimes, 50.0);
+    QJsonObject result;
+    result["type"] = type.c_str();
+    result["channels"] = nchannels;
+    result["getpixel_p50_ms"] = getpixelTime;
+    result["rows_p50_ms"] = rowsTime;
+    result["getpixel_throughput_mps"] = getpixelTime > 0.0 ? megapixels / (getpixelTime / 1000.0) : 0.0;
+    result["rows_throughput_mps"] = rowsTime > 0.0 ? megapixels / (rowsTime / 1000.0) : 0.0;
+    result["speedup"] = rowsTime > 0.0 ? getpixelTime / rowsTime : 0.0;
+    // uint16 values copied as is can differ by one from the float round trip of getpixel
+    result["max_channel_difference"] = maxChannelDifference(getpixelImage, rowsImage);
+    return result;
+}
+
+/**
+ * @brief Scaled read of a file through a fallback path, checked against the expected result.
+ * @param[in] expectImage true if the read must return a fully decoded image of the scaled size, false if it must fail
+ */
+QJsonObject runFallbackCase(const QString& name, const QString& path, const Options& options, bool expectImage)
+{
+    QImageReader reader(path);
+    reader.setScaledSize(QSize(options.scaledSize, options.scaledSize));
+    const QImage image = reader.read();
+    // stage timings (QTOIIO_TRACE): a decode stage means the full image has been decoded
+    const bool fullDecode = !image.text("QtOIIO:decode").isEmpty();
+    // square synthetic images: the scaled size is kept as is
+    const bool passed = expectImage ? image.size() == QSize(options.scaledSize, options.scaledSize) && fullDecode : image.isNull();
+
+    QJsonObject result;
+    result["name"] = name;
+    result["expected"] = expectImage ? "image" : "failure";
+    result["output_width"] = image.width();
+    result["output_height"] = image.height();
+    result["full_decode"] = fullDecode;
+    result["passed"] = passed;
+    return result;
+}
+
+/// fallback paths of the scaled reads, on files derived from the synthetic images
+QJsonArray runFallbackCases(const std::vector<ImageCase>& cases, const QString& directory, const Options& options)
+{
+    QJsonArray fallbacks;
+    for(const ImageCase& imageCase : cases)
+    {
+        if(imageCase.type == oiio::TypeDesc::HALF && imageCase.nchannels == 3 && !imageCase.tiled)
+        {
+            // OpenEXR files have no embedded thumbnail: full decode, then resample
+            fallbacks.append(runFallbackCase("unsupported_format", imageCase.path, options, true));
+            break;
+        }
+    }
+
+    // known extension, not an image: the input cannot be opened
+    const QString notAnImagePath = QDir(directory).filePath("not_an_image.tif");
+    {
+        QFile notAnImage(notAnImagePath);
+        if(notAnImage.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            notAnImage.write("this is not an image\n");
+    }
+    fallbacks.append(runFallbackCase("failed_open", notAnImagePath, options, false));
+
+    for(const ImageCase& imageCase : cases)
+    {
+        if(imageCase.type == oiio::TypeDesc::UINT8 && imageCase.nchannels == 3 && !imageCase.tiled)
+        {
+            // valid header, missing pixel data: the decode fails
+            QFile file(imageCase.path);
+            QFile truncated(QDir(directory).filePath("truncated.tif"));
+            if(file.open(QIODevice::ReadOnly) && truncated.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                truncated.write(file.read(file.size() / 2));
+            truncated.close();
+            fallbacks.append(runFallbackCase("corrupt_data", truncated.fileName(), options, false));
+            break;
+        }
+    }
+    return fallbacks;
+}
+
+QJsonObject runCase(const ImageCase& imageCase, const Options& options, int scaledSize, bool cold, bool mmap, int concurrency, int clipSize = 0)
+{
+    // ScaledSize read if scaledSize > 0 (reduction or enlargement)
+    const bool scaled = scaledSize > 0;
+    // centered region read (ClipRect), full image if clipSize is 0
+    const QRect clipRect = clipSize > 0 ? QRect((options.size - clipSize) / 2, (options.size - clipSize) / 2, clipSize, clipSize) : QRect();
+    // peak RSS of this case: reset the high-water mark, or at least measure from a baseline
+    const bool peakReset = resetPeakRSS();
+    const long baselineRSS = procStatusKB("VmRSS");
+
+    // read by the plugin when the input is opened
+    qputenv("QTOIIO_MMAP", mmap ? "1" : "0");
+
+    std::mutex mutex;
+    std::vector<double> latencies; // ms
+    int failures = 0;
+    QSize outputSize;
+    QImage lastImage;
+    std::vector<double> resampleTimes; // ms, resample stage of the plugin
+
+    // each reader reads the image options.iterations times
+    auto readImages = [&]() {
+        for(int i = 0; i < options.iterations; ++i)
+        {
+            if(cold)
+                evictFromPageCache(imageCase.path);
+
+            QElapsedTimer timer;
+            timer.start();
+            QImageReader reader(imageCase.path);
+            if(scaled)
+                reader.setScaledSize(QSize(scaledSize, scaledSize));
+            if(clipRect.isValid())
+                reader.setClipRect(clipRect);
+            const QImage image = reader.read();
+            const double latency = timer.nsecsElapsed() / 1e6;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if(image.isNull())
+            {
+                ++failures;
+                continue;
+            }
+            outputSize = image.size();
+            lastImage = image;
+            if(image.text("QtOIIO:resample").size() > 0)
+                resampleTimes.push_back(image.text("QtOIIO:resample").toDouble());
+            latencies.push_back(latency);
+        }
+    };
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    if(concurrency <= 1)
+    {
+        readImages();
+    }
+    else
+    {
+        std::vector<std::thread> readers;
+        for(int r = 0; r < concurrency; ++r)
+            readers.emplace_back(readImages);
+        for(std::thread& reader : readers)
+            reader.join();
+    }
+    const double wallTime = wallTimer.nsecsElapsed() / 1e6;
+
+    double total = 0.0;
+    for(double latency : latencies)
+        total += latency;
+    const double mean = latencies.empty() ? 0.0 : total / latencies.size();
+    // decoded pixels: the region for ClipRect reads
+    const double megapixels = clipRect.isValid() ? double(clipSize) * clipSize / 1e6 : double(options.size) * options.size / 1e6;
+
+    QJsonObject result;
+    result["image"] = imageCase.name;
+    result["type"] = imageCase.type.c_str();
+    result["channels"] = imageCase.nchannels;
+    result["colorspace"] = imageCase.linear ? "linear" : "srgb";
+    result["layout"] = imageCase.tiled ? "tiled" : "scanline";
+    result["scaled"] = scaled;
+    result["scaled_size"] = scaledSize;
+    result["clip_size"] = clipSize;
+    result["pagecache"] = cold ? "cold" : "warm";
+    result["mmap"] = mmap;
+    result["concurrency"] = concurrency;
+    result["output_width"] = outputSize.width();
+    result["output_height"] = outputSize.height();
+    result["iterations"] = int(latencies.size());
+    result["failures"] = failures;
+    result["mean_ms"] = mean;
+    result["min_ms"] = percentile(latencies, 0.0);
+    result["p50_ms"] = percentile(latencies, 50.0);
+    result["p90_ms"] = percentile(latencies, 90.0);
+    result["p99_ms"] = percentile(latencies, 99.0);
+    result["max_ms"] = percentile(latencies, 100.0);
+    // aggregated over the concurrent readers
+    result["throughput_mps"] = wallTime > 0.0 ? megapixels * latencies.size() / (wallTime / 1000.0) : 0.0;
+    if(scaled && concurrency == 1 && !lastImage.isNull())
+    {
+        // reference: full resolution read, resized by Qt
+        const QImage fullImage = QImageReader(imageCase.path).read();
+        QImage reference;
+        std::vector<double> qtScaledTimes; // ms
+        for(int i = 0; i < options.iterations; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            reference = fullImage.scaled(outputSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            qtScaledTimes.push_back(timer.nsecsElapsed() / 1e6);
+        }
+        result["scaled_psnr_db"] = psnr(lastImage, reference);
+        result["resample_p50_ms"] = percentile(resampleTimes, 50.0);
+        result["qt_scaled_p50_ms"] = percentile(qtScaledTimes, 50.0);
+    }
+    // ru_maxrss is the process-lifetime high-water mark: use the reset VmHWM for a per-case peak
+    const long casePeakRSS = peakReset ? procStatusKB("VmHWM") : -1;
+    result["peak_rss_kb"] = double(casePeakRSS >= 0 ? casePeakRSS : peakRSS());
+    result["peak_rss_scope"] = casePeakRSS >= 0 ? "case" : "process";
+    result["peak_rss_delta_kb"] = double(casePeakRSS >= 0 && baselineRSS >= 0 ? casePeakRSS - baselineRSS : -1);
+    return result;
+}
+
+bool parseOptions(const QStringList& arguments, Options& options)
+{
+    for(int i = 1; i < arguments.size(); ++i)
+    {
+        const QString& argument = arguments[i];
+        const bool hasValue = i + 1 < arguments.size();
+        if(argument == "--size" && hasValue)
+            options.size = arguments[++i].toInt();
+        else if(argument == "--iterations" && hasValue)
+            options.iterations = arguments[++i].toInt();
+        else if(argument == "--scaled" && hasValue)
+            options.scaledSize = arguments[++i].toInt();
+        else if(argument == "--dir" && hasValue)
+            options.directory = arguments[++i];
+        else if(argument == "--output" && hasValue)
+            options.output = arguments[++i];
+        else if(argument == "--cold")
+            options.cold = true;
+        else if(argument == "--cache")
+            options.cache = true;
+        else if(argument == "--concurrency" && hasValue)
+            options.concurrency = arguments[++i].toInt();
+        else if(argument == "--threads" && hasValue)
+            options.threads = arguments[++i].toInt();
+        else if(argument == "--mmap")
+            options.mmap = true;
+        else
+            return false;
+    }
+    return options.size > 0 && options.iterations > 0 && options.scaledSize > 0 && options.concurrency > 0 && options.threads >= 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    {
+        QStringList arguments;
+        for(int i = 0; i < argc; ++i)
+            arguments << QString::fromLocal8Bit(argv[i]);
+        if(!parseOptions(arguments, options))
+        {
+            QTextStream(stderr) << "Usage: qtoiio_bench [--size N] [--iterations N] [--scaled N] [--dir DIR] [--output FILE] [--cold] [--cache] [--concurrency N] [--threads N] [--mmap]\n";
+            return 1;
+        }
+    }
+
+    // repeated reads of the same file would be served by the decoded-image cache
+    if(!options.cache)
+        qputenv("QTOIIO_CACHE_SIZE", "0");
+    else if(qEnvironmentVariableIsEmpty("QTOIIO_CACHE_SIZE"))
+        qputenv("QTOIIO_CACHE_SIZE", "256");
+    // the case names contain digits ("3ch"): neighboring cases would be prefetched as sequence frames
+    qputenv("QTOIIO_PREFETCH", "0");
+    // stage timings attached to the images (resample time of the scaled reads)
+    qputenv("QTOIIO_TRACE", "1");
+    if(options.threads > 0)
+        qputenv("QTOIIO_THREADS", QByteArray::number(options.threads));
+
+    // headless: no GUI application needed to read images
+    QCoreApplication app(argc, argv);
+    // only load the plugin of this tree: Qt's own image plugins (tiff, jpeg...) would take the files
+    // with their extension, the QtOIIO plugin takes them from their content
+    QCoreApplication::setLibraryPaths(QStringList{QTOIIO_BENCH_PLUGIN_DIR});
+
+    QJsonObject startup;
+    {
+        // plugins loading (QtOIIO constructor), then the first read (plugin initialization)
+        QElapsedTimer timer;
+        timer.start();
+        const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+        startup["plugins_load_ms"] = timer.nsecsElapsed() / 1e6;
+        startup["supported_formats"] = formats.size();
+    }
+
+    QTemporaryDir temporaryDirectory;
+    const QString directory = options.directory.isEmpty() ? temporaryDirectory.path() : options.directory;
+    QDir().mkpath(directory);
+    QTextStream(stderr) << "Generating images in " << directory << "\n";
+    const std::vector<ImageCase> cases = generateImages(directory, options.size);
+    if(cases.empty())
+        return 1;
+
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QImageReader reader(cases.front().path);
+        const bool canRead = reader.canRead();
+        startup["first_query_ms"] = timer.nsecsElapsed() / 1e6;
+        startup["first_query_can_read"] = canRead;
+    }
+    {
+        // following queries: cost of the plugin selection for each image of a folder (thumbnails, sequences)
+        const int queryCount = 1000;
+        QElapsedTimer timer;
+        timer.start();
+        for(int i = 0; i < queryCount; ++i)
+            QImageReader(cases.front().path).canRead();
+        startup["query_count"] = queryCount;
+        startup["query_mean_ms"] = timer.nsecsElapsed() / 1e6 / queryCount;
+    }
+
+    QJsonArray results;
+    for(const ImageCase& imageCase : cases)
+    {
+        for(bool scaled : {false, true})
+        {
+            for(bool cold : {false, true})
+            {
+                if(cold && !options.cold)
+                    continue;
+                for(bool mmap : {false, true})
+                {
+                    if(mmap && !options.mmap)
+                        continue;
+                    // 1, 2, 4... concurrent readers, up to options.concurrency
+                    for(int concurrency = 1; ; concurrency = std::min(concurrency * 2, options.concurrency))
+                    {
+                        QTextStream(stderr) << imageCase.name << (scaled ? " scaled" : "") << (cold ? " cold" : "") << (mmap ? " mmap" : "") << " x" << concurrency << "\n";
+                        results.append(runCase(imageCase, options, scaled ? options.scaledSize : 0, cold, mmap, concurrency));
+                        if(concurrency == options.concurrency)
+                            break;
+                    }
+                }
+            }
+        }
+
+        // region reads: the cost should scale with the ROI size, not with the image size
+        for(int clipDivisor : {8, 4, 2})
+        {
+            const int clipSize = options.size / clipDivisor;
+            if(clipSize <= 0)
+                continue;
+            QTextStream(stderr) << imageCase.name << " clip " << clipSize << "\n";
+            results.append(runCase(imageCase, options, 0, false, false, 1, clipSize));
+        }
+
+        // enlargement: resample filter of the upscaled reads
+        QTextStream(stderr) << imageCase.name << " upscale " << options.size * 2 << "\n";
+        results.append(runCase(imageCase, options, options.size * 2, false, false, 1));
+    }
+
+    // conversion of the decoded pixels to 16-bit RGBA, in memory
+    QJsonArray conversions;
+    const oiio::TypeDesc conversionTypes[] = {oiio::TypeDesc::UINT8, oiio::TypeDesc::UINT16, oiio::TypeDesc::HALF, oiio::TypeDesc::FLOAT};
+    for(const oiio::TypeDesc& type : conversionTypes)
+    {
+        for(int nchannels : {1, 3, 4})
+        {
+            QTextStream(stderr) << "conversion " << type.c_str() << " " << nchannels << "ch\n";
+            conversions.append(runConversionCase(type, nchannels, options));
+        }
+    }
+
+    // fallback paths: checked results
+    QTextStream(stderr) << "fallbacks\n";
+    const QJsonArray fallbacks = runFallbackCases(cases, directory, options);
+    bool fallbacksPassed = true;
+    for(const QJsonValue& fallback : fallbacks)
+        fallbacksPassed = fallbacksPassed && fallback.toObject()["passed"].toBool();
+
+    QJsonObject report;
+    report["size"] = options.size;
+    report["scaled_size"] = options.scaledSize;
+    report["iterations"] = options.iterations;
+    report["concurrency"] = options.concurrency;
+    report["threads"] = options.threads;
+    report["oiio_version"] = OIIO_VERSION_STRING;
+    report["qt_version"] = qVersion();
+    report["startup"] = startup;
+    report["results"] = results;
+    report["conversions"] = conversions;
+    report["fallbacks"] = fallbacks;
+    report["fallbacks_passed"] = fallbacksPassed;
+    report["peak_rss_kb"] = double(peakRSS());
+
+    const QByteArray json = QJsonDocument(report).toJson();
+    if(options.output.isEmpty())
+    {
+        QTextStream(stdout) << json;
+        return fallbacksPassed ? 0 : 2;
+    }
+    QFile outputFile(options.output);
+    if(!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return 1;
+    outputFile.write(json);
+    return fallbacksPassed ? 0 : 2;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "jetColorMap.hpp"
+
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Color map precomputed in a high resolution lookup table.
+ *
+ * Values in [0, 1] are mapped to the table, values below/above the range and NaN values
+ * are mapped to dedicated entries. Each entry is stored as float RGB (Color32f) and as
+ * a packed 32-bit pixel (0xffRRGGBB, the QImage::Format_RGB32 layout).
+ * Row conversions compute the table indices without branches so that the loops can be
+ * auto-vectorized by the compiler.
+ */
+class ColorMapLut
+{
+public:
+    /// number of entries used to sample the [0, 1] range
+    static const int resolution = 4096;
+
+    /// Jet color map, black below 0, white above 1 (same as getColor32fFromJetColorMap)
+    static const ColorMapLut& jet()
+    {
+        static const ColorMapLut lut(&getColor32fFromJetColorMap, Color32f(0.0f, 0.0f, 0.0f), Color32f(1.0f, 1.0f, 1.0f));
+        return lut;
+    }
+
+    /// Jet color map, clamped to [0, 1] (same as getColor32fFromJetColorMapClamp)
+    static const ColorMapLut& jetClamp()
+    {
+        // above the range: last table entry
+        static const ColorMapLut lut(&getColor32fFromJetColorMapClamp, getColor32fFromJetColorMapClamp(0.0f), Color32f(jetr[63], jetg[63], jetb[63]));
+        return lut;
+    }
+
+    /**
+     * @brief Get a color map of OpenImageIO, clamped to [0, 1].
+     * @param[in] name color map name, perceptually uniform: "inferno", "viridis", "magma", "plasma",
+     *            others: "blue-red", "spectrum", "heat"
+     * @return the color map, or nullptr if the name is not a known color map
+     */
+    static const ColorMapLut* named(const std::string& name)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::unique_ptr<ColorMapLut>> luts;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = luts.find(name);
+        if(it == luts.end())
+            it = luts.emplace(name, fromOIIOColorMap(name)).first;
+        return it->second.get();
+    }
+
+    /// Color of a value
+    Color32f operator()(float value) const
+    {
+        return _colors[index(value)];
+    }
+
+    /// Packed 32-bit color (0xffRRGGBB) of a value
+    std::uint32_t packed(float value) const
+    {
+        return _packed[index(value)];
+    }
+
+    /**
+     * @brief Convert a row of values to packed 32-bit colors (0xffRRGGBB).
+     *        The value used for the lookup is: src[x] * scale + offset.
+     * @param[in] src input values (float or uint16)
+     * @param[in] width number of values
+     * @param[out] dst output colors
+     */
+    template <typename T>
+    void convertRow(const T* src, int width, std::uint32_t* dst, float scale = 1.0f, float offset = 0.0f) const
+    {
+        const std::uint32_t* packedColors = _packed.data();
+        for(int x = 0; x < width; ++x)
+            dst[x] = packedColors[index(static_cast<float>(src[x]) * scale + offset)];
+    }
+
+private:
+    enum
+    {
+        belowIndex = resolution,
+        aboveIndex = resolution + 1,
+        nanIndex = resolution + 2,
+        size = resolution + 3
+    };
+
+    ColorMapLut(Color32f (*colorFunction)(float), const Color32f& below, const Color32f& above)
+        : _colors(size)
+    {
+        // sample inside the open range (0, 1): the range bounds are handled by the below/above entries
+        const float epsilon = 1e-6f;
+        for(int i = 0; i < resolution; ++i)
+            _colors[i] = colorFunction(std::min(std::max(float(i) / float(resolution - 1), epsilon), 1.0f - epsilon));
+        _colors[belowIndex] = below;
+        _colors[aboveIndex] = above;
+        _colors[nanIndex] = colorFunction(std::numeric_limits<float>::quiet_NaN());
+        pack();
+    }
+
+    explicit ColorMapLut(const std::vector<Color32f>& colors)
+        : _colors(colors)
+    {
+        pack();
+    }
+
+    static std::unique_ptr<ColorMapLut> fromOIIOColorMap(const std::string& name)
+    {
+        // evaluate the OIIO color map on a ramp of values in [0, 1] followed by NaN
+        const OIIO::ImageSpec rampSpec(resolution + 1, 1, 1, OIIO::TypeDesc::FLOAT);
+        OIIO::ImageBuf rampBuf(rampSpec);
+        float* ramp = static_cast<float*>(rampBuf.localpixels());
+        for(int i = 0; i < resolution; ++i)
+            ramp[i] = float(i) / float(resolution - 1);
+        ramp[resolution] = std::numeric_limits<float>::quiet_NaN();
+
+        OIIO::ImageBuf colorBuf;
+        if(!OIIO::ImageBufAlgo::color_map(colorBuf, rampBuf, 0, name))
+            return nullptr;
+
+        std::vector<float> rgb(3 * (resolution + 1));
+        OIIO::ROI roi = colorBuf.roi();
+        roi.chbegin = 0;
+        roi.chend = 3;
+        if(!colorBuf.get_pixels(roi, OIIO::TypeDesc::FLOAT, rgb.data()))
+            return nullptr;
+
+        std::vector<Color32f> colors(size);
+        for(int i = 0; i < resolution; ++i)
+            colors[i] = Color32f(rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]);
+        colors[belowIndex] = colors[0];
+        colors[aboveIndex] = colors[resolution - 1];
+        colors[nanIndex] = Color32f(rgb[3 * resolution], rgb[3 * resolution + 1], rgb[3 * resolution + 2]);
+        return std::unique_ptr<ColorMapLut>(new ColorMapLut(colors));
+    }
+
+    static int index(float value)
+    {
+        // clamped value in [0, 1] (NaN is mapped to 0), then dedicated entries
+        float t = value > 0.0f ? value : 0.0f;
+        t = t < 1.0f ? t : 1.0f;
+        int i = static_cast<int>(t * float(resolution - 1) + 0.5f);
+        i = value <= 0.0f ? int(belowIndex) : i;
+        i = value >= 1.0f ? int(aboveIndex) : i;
+        i = value != value ? int(nanIndex) : i;
+        return i;
+    }
+
+    static std::uint8_t toByte(float v)
+    {
+        v = v > 0.0f ? v : 0.0f;
+        v = v < 1.0f ? v : 1.0f;
+        return static_cast<std::uint8_t>(v * 255.0f + 0.5f);
+    }
+
+    void pack()
+    {
+        _packed.resize(_colors.size());
+        for(std::size_t i = 0; i < _colors.size(); ++i)
+        {
+            const Color32f& c = _colors[i];
+            _packed[i] = 0xff000000u | (std::uint32_t(toByte(c.r)) << 16) | (std::uint32_t(toByte(c.g)) << 8) | std::uint32_t(toByte(c.b));
+        }
+    }
+
+    std::vector<Color32f> _colors;
+    std::vector<std::uint32_t> _packed;
+};
@@ -3,7 +3,8 @@
 #include "mv_point2d.hpp"
 #include "mv_matrix3x3.hpp"
 
-#include "../jetColorMap.hpp"
+#include "../colorMapLut.hpp"
+#include "../sharedImageCache.hpp"
 
 #include <Qt3DRender/QEffect>
 #include <Qt3DRender/QTechnique>
@@ -14,7 +15,9 @@
 #include <Qt3DRender/QBuffer>
 #include <Qt3DCore/QTransform>
 
+#include <QDateTime>
 #include <QDebug>
+#include <QFileInfo>
 
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
@@ -278,7 +281,8 @@ void DepthMapEntity::loadDepthMap()
     configSpec.attribute("raw:ColorSpace", "sRGB");   // want colorspace sRGB
     configSpec.attribute("raw:use_camera_matrix", 3); // want to use embeded color profile
 
-    oiio::ImageBuf inBuf(_source.toLocalFile().toStdString(), 0, 0, NULL, &configSpec);
+    invalidateSharedImageCacheIfModified(_source.toLocalFile().toStdString(), QFileInfo(_source.toLocalFile()).lastModified().toMSecsSinceEpoch());
+    oiio::ImageBuf inBuf(_source.toLocalFile().toStdString(), 0, 0, getSharedImageCache(), &configSpec);
     const oiio::ImageSpec& inSpec = inBuf.spec();
 
     qDebug() << "[DepthMapEntity] Image Size: " << inSpec.width << "x" << inSpec.height;
@@ -313,7 +317,8 @@ void DepthMapEntity::loadDepthMap()
     if(simPath.isValid())
     {
         qDebug() << "[DepthMapEntity] Load Sim Map: " << simPath;
-        simBuf.reset(simPath.toLocalFile().toStdString(), 0, 0, NULL, &configSpec);
+        invalidateSharedImageCacheIfModified(simPath.toLocalFile().toStdString(), QFileInfo(simPath.toLocalFile()).lastModified().toMSecsSinceEpoch());
+        simBuf.reset(simPath.toLocalFile().toStdString(), 0, 0, getSharedImageCache(), &configSpec);
     }
 
     const oiio::ImageSpec& simSpec = simBuf.spec();
@@ -322,6 +327,8 @@ void DepthMapEntity::loadDepthMap()
     oiio::ImageBufAlgo::PixelStats stats;
     oiio::ImageBufAlgo::computePixelStats(stats, inBuf);
 
+    const ColorMapLut& colorMap = ColorMapLut::jetClamp();
+
     std::vector<int> indexPerPixel(inSpec.width * inSpec.height, -1);
     std::vector<Vec3f> positions;
     std::vector<Color32f> colors;
@@ -345,20 +352,21 @@ void DepthMapEntity::loadDepthMap()
             {
                 float simValue = 0.0f;
                 simBuf.getpixel(x, y, &simValue, 1);
-                Color32f color = getColor32fFromJetColorMapClamp(simValue);
+                Color32f color = colorMap(simValue);
                 colors.push_back(color);
             }
             else
             {
                 const float range = stats.max[0] - stats.min[0];
                 float normalizedDepthValue = range != 0.0f ? (depthValue - stats.min[0]) / range : 1.0f;
-                Color32f color = getColor32fFromJetColorMapClamp(normalizedDepthValue);
+                Color32f color = colorMap(normalizedDepthValue);
                 colors.push_back(color);
             }
         }
     }
 
     qDebug() << "[DepthMapEntity] Valid Depth Values: " << positions.size();
+    qDebug().noquote() << "[DepthMapEntity] ImageCache statistics: " << QString::fromStdString(getSharedImageCacheStats());
 
     // create geometry
     QGeometry* customGeometry = new QGeometry;
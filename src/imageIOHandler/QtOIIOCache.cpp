@@ -0,0 +1,122 @@
+#include "QtOIIOCache.hpp"
+
+#include <QDebug>
+#include <QHash>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+namespace {
+
+// opt-in: applications loading images through the plugin do not keep decoded images by default
+const qint64 defaultCacheSizeMB = 0;
+
+qint64 cacheSizeFromEnv()
+{
+    const char* cacheSizeEnv = std::getenv("QTOIIO_CACHE_SIZE");
+    if(!cacheSizeEnv)
+        return defaultCacheSizeMB * 1024 * 1024;
+    return std::max(0ll, std::atoll(cacheSizeEnv)) * 1024 * 1024;
+}
+
+} // namespace
+
+std::size_t QtOIIOCache::KeyHash::operator()(const Key& key) const
+{
+    std::size_t h = qHash(key.path);
+    h = h * 31 + std::hash<qint64>()(key.lastModified);
+    h = h * 31 + std::hash<int>()(key.subimage);
+    h = h * 31 + std::hash<int>()(key.scaledSize.width());
+    h = h * 31 + std::hash<int>()(key.scaledSize.height());
+    h = h * 31 + std::hash<int>()(key.clipRect.x());
+    h = h * 31 + std::hash<int>()(key.clipRect.y());
+    h = h * 31 + std::hash<int>()(key.clipRect.width());
+    h = h * 31 + std::hash<int>()(key.clipRect.height());
+    h = h * 31 + std::hash<int>()(key.scaledClipRect.x());
+    h = h * 31 + std::hash<int>()(key.scaledClipRect.y());
+    h = h * 31 + std::hash<int>()(key.scaledClipRect.width());
+    h = h * 31 + std::hash<int>()(key.scaledClipRect.height());
+    h = h * 31 + qHash(key.conversion);
+    return h;
+}
+
+QtOIIOCache& QtOIIOCache::instance()
+{
+    static QtOIIOCache cache(cacheSizeFromEnv());
+    return cache;
+}
+
+QtOIIOCache::QtOIIOCache(qint64 maxBytes)
+    : _maxBytes(maxBytes)
+{
+}
+
+bool QtOIIOCache::find(const Key& key, QImage& image)
+{
+    QMutexLocker lock(&_mutex);
+    const auto it = _index.find(key);
+    if(it == _index.end())
+    {
+        ++_misses;
+        return false;
+    }
+    // move to front (most recently used)
+    _entries.splice(_entries.begin(), _entries, it->second);
+    image = it->second->image;
+    ++_hits;
+    return true;
+}
+
+bool QtOIIOCache::contains(const Key& key) const
+{
+    QMutexLocker lock(&_mutex);
+    return _index.find(key) != _index.end();
+}
+
+void QtOIIOCache::insert(const Key& key, const QImage& image)
+{
+    const qint64 imageBytes = image.sizeInBytes();
+    if(image.isNull() || imageBytes > _maxBytes)
+        return;
+
+    QMutexLocker lock(&_mutex);
+    const auto it = _index.find(key);
+    if(it != _index.end())
+    {
+        _bytes -= it->second->bytes;
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+    _entries.push_front(Entry{key, image, imageBytes});
+    _index.emplace(key, _entries.begin());
+    _bytes += imageBytes;
+    evict();
+}
+
+void QtOIIOCache::clear()
+{
+    QMutexLocker lock(&_mutex);
+    _index.clear();
+    _entries.clear();
+    _bytes = 0;
+}
+
+qint64 QtOIIOCache::bytes() const
+{
+    QMutexLocker lock(&_mutex);
+    return _bytes;
+}
+
+void QtOIIOCache::evict()
+{
+    while(_bytes > _maxBytes && !_entries.empty())
+    {
+        const Entry& entry = _entries.back();
+        qDebug() << "[QtOIIO] Cache evict: " << entry.key.path;
+        _bytes -= entry.bytes;
+        _index.erase(entry.key);
+        _entries.pop_back();
+    }
+}
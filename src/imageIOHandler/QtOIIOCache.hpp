@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QString>
+
+#include <atomic>
+#include <list>
+#include <unordered_map>
+
+/**
+ * @brief Process-wide cache of decoded images, shared by all QtOIIOHandler instances.
+ *
+ * Images are stored as implicitly shared QImages: a cache hit hands out the cached image
+ * without copying pixels. When the total size of the cached images exceeds the memory budget,
+ * the least recently used images are evicted.
+ * The budget of the shared instance is set by the QTOIIO_CACHE_SIZE environment variable (in MB).
+ */
+class QtOIIOCache
+{
+public:
+    struct Key
+    {
+        QString path;
+        qint64 lastModified = 0; // msecs since epoch
+        int subimage = 0;
+        QSize scaledSize;
+        QRect clipRect;
+        QRect scaledClipRect;
+        QString conversion; // conversion mode (color map, options...)
+
+        bool operator==(const Key& other) const
+        {
+            return path == other.path && lastModified == other.lastModified && subimage == other.subimage &&
+                   scaledSize == other.scaledSize && clipRect == other.clipRect &&
+                   scaledClipRect == other.scaledClipRect && conversion == other.conversion;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const;
+    };
+
+public:
+    /// Process-wide instance
+    static QtOIIOCache& instance();
+
+    explicit QtOIIOCache(qint64 maxBytes);
+
+    /**
+     * @brief Find an image in the cache and mark it as most recently used.
+     * @return true on cache hit
+     */
+    bool find(const Key& key, QImage& image);
+
+    /// Check if an image is in the cache, without changing its usage or the statistics.
+    bool contains(const Key& key) const;
+
+    /// Insert an image, evicting the least recently used ones to fit in the memory budget.
+    void insert(const Key& key, const QImage& image);
+
+    void clear();
+
+    qint64 maxBytes() const { return _maxBytes; }
+    qint64 bytes() const;
+    quint64 hits() const { return _hits; }
+    quint64 misses() const { return _misses; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        QImage image;
+        qint64 bytes;
+    };
+    using EntryList = std::list<Entry>;
+
+    void evict();
+
+    const qint64 _maxBytes;
+    mutable QMutex _mutex;
+    EntryList _entries; // most recently used first
+    std::unordered_map<Key, EntryList::iterator, KeyHash> _index;
+    qint64 _bytes = 0;
+    std::atomic<quint64> _hits{0};
+    std::atomic<quint64> _misses{0};
+};
@@ -1,10 +1,22 @@
 #include "QtOIIOHandler.hpp"
+#include "QtOIIOCache.hpp"
+#include "colorTransform.hpp"
+#include "deviceProxy.hpp"
+#include "formatProbe.hpp"
+#include "readTrace.hpp"
+#include "rowConversion.hpp"
+#include "sequencePrefetcher.hpp"
+#include "threadBudget.hpp"
+#include "valueRange.hpp"
 
-#include "../jetColorMap.hpp"
+#include "../colorMapLut.hpp"
+#include "../sharedImageCache.hpp"
 
 #include <QImage>
 #include <QIODevice>
 #include <QFileDevice>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QVariant>
 #include <QDataStream>
 #include <QDebug>
@@ -12,26 +24,424 @@
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/filter.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 namespace oiio = OIIO;
 
-inline const float& clamp( const float& v, const float& lo, const float& hi )
+namespace {
+
+/**
+ * @brief Find the smallest MIP level of a tiled/mipmapped file that is still at least
+ *        as large as the image displayed for the requested scaled size.
+ * @param[in] formatName OIIO format of the file
+ * @param[in] getMipSpec function (int miplevel, oiio::ImageSpec& spec) -> bool reading the spec
+ *            of a MIP level of the subimage, false if there is no such level
+ * @param[in,out] clipRect region to decode in full resolution coordinates (if valid),
+ *                converted to the coordinates of the returned MIP level
+ * @return the MIP level to decode, 0 if the file has no MIP levels
+ */
+template <typename GetMipSpec>
+int findMipLevelForScaledSize(const std::string& formatName, GetMipSpec&& getMipSpec, const QSize& scaledSize, QRect& clipRect)
+{
+    // only these formats can store MIP levels
+    if(formatName != "openexr" && formatName != "tiff")
+        return 0;
+
+    oiio::ImageSpec spec;
+    if(!getMipSpec(0, spec))
+        return 0;
+
+    // size of the decoded region once the pixel aspect ratio is applied and fitted in the scaled size
+    const float pixelAspectRatio = spec.get_float_attribute("PixelAspectRatio", 1.0f);
+    const QSize regionSize = clipRect.isValid() ? clipRect.size() : QSize(spec.width, spec.height);
+    const QSize targetSize = QSize(regionSize.width() * pixelAspectRatio, regionSize.height()).scaled(scaledSize, Qt::KeepAspectRatio);
+
+    int miplevel = 0;
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    oiio::ImageSpec mipSpec;
+    while(getMipSpec(miplevel + 1, mipSpec))
+    {
+        const float mipScaleX = float(mipSpec.width) / float(spec.width);
+        const float mipScaleY = float(mipSpec.height) / float(spec.height);
+        if(regionSize.width() * mipScaleX * pixelAspectRatio < targetSize.width() || regionSize.height() * mipScaleY < targetSize.height())
+            break;
+        scaleX = mipScaleX;
+        scaleY = mipScaleY;
+        ++miplevel;
+    }
+
+    if(miplevel > 0 && clipRect.isValid())
+    {
+        const int left = std::floor(clipRect.left() * scaleX);
+        const int top = std::floor(clipRect.top() * scaleY);
+        const int right = std::ceil((clipRect.right() + 1) * scaleX);
+        const int bottom = std::ceil((clipRect.bottom() + 1) * scaleY);
+        clipRect = QRect(left, top, right - left, bottom - top);
+    }
+    return miplevel;
+}
+
+/**
+ * @brief Decode only the scanlines or tiles of an image intersecting a region.
+ * @param[in] roi region to decode, in the pixel coordinates of the MIP level
+ * @param[out] regionBuf decoded region (with its origin at (0, 0) if only a part of the image is read)
+ * @return true on success
+ */
+bool readImageRegion(oiio::ImageInput& in, int subimage, int miplevel, const oiio::ROI& roi, oiio::ImageBuf& regionBuf)
+{
+    if(!in.seek_subimage(subimage, miplevel))
+        return false;
+
+    const oiio::ImageSpec& spec = in.spec();
+
+    // extend the region to what has to be decoded: whole tiles or full width scanlines
+    oiio::ROI readROI = roi;
+    readROI.zbegin = spec.z;
+    readROI.zend = spec.z + std::max(spec.depth, 1);
+    readROI.chbegin = 0;
+    readROI.chend = spec.nchannels;
+    const bool tiled = spec.tile_width > 0 && spec.tile_height > 0;
+    if(tiled)
+    {
+        readROI.xbegin = spec.x + ((roi.xbegin - spec.x) / spec.tile_width) * spec.tile_width;
+        readROI.ybegin = spec.y + ((roi.ybegin - spec.y) / spec.tile_height) * spec.tile_height;
+        readROI.xend = std::min(spec.x + spec.width, spec.x + ((roi.xend - spec.x + spec.tile_width - 1) / spec.tile_width) * spec.tile_width);
+        readROI.yend = std::min(spec.y + spec.height, spec.y + ((roi.yend - spec.y + spec.tile_height - 1) / spec.tile_height) * spec.tile_height);
+    }
+    else
+    {
+        readROI.xbegin = spec.x;
+        readROI.xend = spec.x + spec.width;
+    }
+
+    oiio::ImageSpec readSpec = spec;
+    readSpec.x = readROI.xbegin;
+    readSpec.y = readROI.ybegin;
+    readSpec.width = readROI.width();
+    readSpec.height = readROI.height();
+    readSpec.tile_width = 0;
+    readSpec.tile_height = 0;
+    readSpec.tile_depth = 0;
+    readSpec.channelformats.clear(); // read all channels as spec.format
+    oiio::ImageBuf readBuf(readSpec);
+
+    bool success = false;
+    if(tiled)
+        success = in.read_tiles(readROI.xbegin, readROI.xend, readROI.ybegin, readROI.yend, readROI.zbegin, readROI.zend,
+                                readROI.chbegin, readROI.chend, spec.format, readBuf.localpixels());
+    else
+        success = in.read_scanlines(readROI.ybegin, readROI.yend, readROI.zbegin, readROI.chbegin, readROI.chend,
+                                    spec.format, readBuf.localpixels());
+    if(!success)
+    {
+        qWarning() << "[QtOIIO] Failed to read image region: " << in.geterror().c_str();
+        return false;
+    }
+
+    // the whole decoded area was requested: no need to crop
+    if(readROI.xbegin == roi.xbegin && readROI.xend == roi.xend && readROI.ybegin == roi.ybegin && readROI.yend == roi.yend)
+    {
+        regionBuf.swap(readBuf);
+        return true;
+    }
+
+    // crop to the requested region (moved to the origin)
+    oiio::ROI cutROI = roi;
+    cutROI.chbegin = 0;
+    cutROI.chend = spec.nchannels;
+    return oiio::ImageBufAlgo::cut(regionBuf, readBuf, cutROI);
+}
+
+#if OIIO_VERSION >= (10000 * 2 + 100 * 3 + 0) // OIIO_VERSION >= 2.3.0
+/**
+ * @brief Read the preview/thumbnail embedded in the file metadata (EXIF thumbnail, RAW preview...)
+ *        if it is large enough to be displayed at the requested scaled size.
+ *
+ * Policy to get the same result as the full decode:
+ *  - orientation: embedded thumbnails are stored like the main image, so the thumbnail is
+ *    returned untransformed and Qt applies the orientation reported for the main image.
+ *    A thumbnail whose aspect ratio differs from the main image (rotated or letterboxed
+ *    previews) is rejected.
+ *  - color space: embedded thumbnails are 8-bit display images, they are used as sRGB.
+ *  - grayscale images are displayed with a color map, their thumbnails are never used.
+ *
+ * @return the thumbnail, or a null QImage if the full image has to be decoded
+ */
+QImage readEmbeddedThumbnail(oiio::ImageInput& in, const QSize& scaledSize)
+{
+    if(!in.seek_subimage(0, 0))
+        return QImage();
+
+    const oiio::ImageSpec& spec = in.spec();
+    const int thumbnailWidth = spec.get_int_attribute("thumbnail_width", 0);
+    const int thumbnailHeight = spec.get_int_attribute("thumbnail_height", 0);
+    if(spec.nchannels < 3 || thumbnailWidth <= 0 || thumbnailHeight <= 0)
+        return QImage();
+
+    const float pixelAspectRatio = spec.get_float_attribute("PixelAspectRatio", 1.0f);
+    const QSize fullSize(spec.width * pixelAspectRatio, spec.height);
+    const QSize targetSize = fullSize.scaled(scaledSize, Qt::KeepAspectRatio);
+    if(thumbnailWidth < targetSize.width() || thumbnailHeight < targetSize.height())
+        return QImage();
+
+    const float fullRatio = float(fullSize.width()) / float(fullSize.height());
+    const float thumbnailRatio = float(thumbnailWidth) / float(thumbnailHeight);
+    if(std::abs(thumbnailRatio - fullRatio) > 0.02f * fullRatio)
+        return QImage();
+
+    oiio::ImageBuf thumbnailBuf;
+    if(!in.get_thumbnail(thumbnailBuf, 0) || !thumbnailBuf.initialized() || thumbnailBuf.nchannels() < 3)
+        return QImage();
+
+    QImage thumbnail(thumbnailBuf.spec().width, thumbnailBuf.spec().height, QImage::Format_RGB888);
+    oiio::ROI exportROI = thumbnailBuf.roi();
+    exportROI.chbegin = 0;
+    exportROI.chend = 3;
+    if(!thumbnailBuf.get_pixels(exportROI, oiio::TypeDesc::UINT8, thumbnail.bits(), 3, thumbnail.bytesPerLine()))
+        return QImage();
+
+    return thumbnail.convertToFormat(QImage::Format_RGB32);
+}
+#endif
+
+/**
+ * @brief Get the configuration used to open images (LibRAW settings).
+ */
+oiio::ImageSpec getReadConfigSpec()
+{
+    oiio::ImageSpec configSpec;
+    // libRAW configuration
+    //configSpec.attribute("raw:user_flip", 0);
+    configSpec.attribute("raw:auto_bright", 0);       // don't want exposure correction
+    configSpec.attribute("raw:use_camera_wb", 1);     // want white balance correction
+#if OIIO_VERSION <= (10000 * 2 + 100 * 0 + 8) // OIIO_VERSION <= 2.0.8
+    // In these previous versions of oiio, there was no Linear option
+    configSpec.attribute("raw:ColorSpace", "sRGB");   // want colorspace sRGB
+#else
+    configSpec.attribute("raw:ColorSpace", "Linear");   // want linear colorspace with sRGB primaries
+#endif
+    configSpec.attribute("raw:use_camera_matrix", 3); // want to use embeded color profile
+    return configSpec;
+}
+
+/**
+ * @brief Get the pixel layout of a QImage for an ImageOutput, the image is only converted
+ *        if OIIO cannot read its memory as is (interleaved gray/RGB/RGBA channels).
+ * @param[in,out] image image to write
+ * @param[out] format type of the channels
+ * @param[out] nchannels number of channels to write
+ * @param[out] xstride distance in bytes between two pixels
+ */
+void getOutputPixelLayout(QImage& image, oiio::TypeDesc& format, int& nchannels, oiio::stride_t& xstride)
+{
+    switch(image.format())
+    {
+    case QImage::Format_Grayscale8:
+        format = oiio::TypeDesc::UINT8; nchannels = 1; xstride = 1; return;
+    case QImage::Format_RGB888:
+        format = oiio::TypeDesc::UINT8; nchannels = 3; xstride = 3; return;
+    case QImage::Format_RGBX8888:
+        format = oiio::TypeDesc::UINT8; nchannels = 3; xstride = 4; return;
+    case QImage::Format_RGBA8888:
+        format = oiio::TypeDesc::UINT8; nchannels = 4; xstride = 4; return;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    case QImage::Format_Grayscale16:
+        format = oiio::TypeDesc::UINT16; nchannels = 1; xstride = 2; return;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    case QImage::Format_RGBX64:
+        format = oiio::TypeDesc::UINT16; nchannels = 3; xstride = 8; return;
+    case QImage::Format_RGBA64:
+        format = oiio::TypeDesc::UINT16; nchannels = 4; xstride = 8; return;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    case QImage::Format_RGBX16FPx4:
+        format = oiio::TypeDesc::HALF; nchannels = 3; xstride = 8; return;
+    case QImage::Format_RGBA16FPx4:
+        format = oiio::TypeDesc::HALF; nchannels = 4; xstride = 8; return;
+    case QImage::Format_RGBX32FPx4:
+        format = oiio::TypeDesc::FLOAT; nchannels = 3; xstride = 16; return;
+    case QImage::Format_RGBA32FPx4:
+        format = oiio::TypeDesc::FLOAT; nchannels = 4; xstride = 16; return;
+#endif
+    default:
+        break;
+    }
+
+    // other formats (ARGB32, RGB32, premultiplied, indexed...) store the channels in another order:
+    // convert to interleaved RGB(A), keeping 16 bits per channel for deep images
+    nchannels = image.hasAlphaChannel() ? 4 : 3;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    if(image.depth() > 32)
+    {
+        image = image.convertToFormat(nchannels == 4 ? QImage::Format_RGBA64 : QImage::Format_RGBX64);
+        format = oiio::TypeDesc::UINT16;
+        xstride = 8;
+        return;
+    }
+#endif
+    image = image.convertToFormat(nchannels == 4 ? QImage::Format_RGBA8888 : QImage::Format_RGBX8888);
+    format = oiio::TypeDesc::UINT8;
+    xstride = 4;
+}
+
+/**
+ * @brief Get the pixel layout of a QImage for ImageBufAlgo, the channels order does not matter
+ *        as long as all channels are filtered the same way.
+ * @param[out] format type of the channels
+ * @param[out] nchannels number of channels
+ * @return false if OIIO cannot process the image memory as is
+ */
+bool getResamplePixelLayout(const QImage& image, oiio::TypeDesc& format, int& nchannels)
+{
+    switch(image.format())
+    {
+    case QImage::Format_Grayscale8:
+        format = oiio::TypeDesc::UINT8; nchannels = 1; return true;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        format = oiio::TypeDesc::UINT8; nchannels = 4; return true;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    case QImage::Format_Grayscale16:
+        format = oiio::TypeDesc::UINT16; nchannels = 1; return true;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    case QImage::Format_RGBX64:
+    case QImage::Format_RGBA64_Premultiplied:
+        format = oiio::TypeDesc::UINT16; nchannels = 4; return true;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    case QImage::Format_RGBX16FPx4:
+    case QImage::Format_RGBA16FPx4_Premultiplied:
+        format = oiio::TypeDesc::HALF; nchannels = 4; return true;
+    case QImage::Format_RGBX32FPx4:
+    case QImage::Format_RGBA32FPx4_Premultiplied:
+        format = oiio::TypeDesc::FLOAT; nchannels = 4; return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Resample an image to its display size in a single filtered pass (multithreaded by OIIO):
+ *        pixel aspect ratio correction, fit in the scaled size and scaled clip rect.
+ *        Like QImage smooth scaling, reductions average the source pixels (box filter) and
+ *        enlargements interpolate them (triangle filter): both filters are non-negative, so
+ *        premultiplied colors never exceed their alpha, and a reduction reads each source pixel once.
+ *        The pixels are resampled from the image memory straight into the output image.
+ *        Images with an alpha channel are premultiplied first, like QImage::scaled does.
+ * @param[in] image decoded image
+ * @param[in] outputSize size of the whole resampled image
+ * @param[in] outputClip region of the resampled image to output (if valid), within outputSize
+ * @return the resampled image, a null image if the image format is not supported
+ */
+QImage resampleImage(const QImage& image, const QSize& outputSize, const QRect& outputClip)
+{
+    const QRect outputRect(QPoint(0, 0), outputSize);
+    const QRect clip = outputClip.isValid() ? outputClip : outputRect;
+    if(!outputRect.contains(clip))
+        return QImage();
+
+    QImage src = image;
+    switch(src.format())
+    {
+    case QImage::Format_ARGB32:
+        src = src.convertToFormat(QImage::Format_ARGB32_Premultiplied); break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    case QImage::Format_RGBA64:
+        src = src.convertToFormat(QImage::Format_RGBA64_Premultiplied); break;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    case QImage::Format_RGBA16FPx4:
+        src = src.convertToFormat(QImage::Format_RGBA16FPx4_Premultiplied); break;
+    case QImage::Format_RGBA32FPx4:
+        src = src.convertToFormat(QImage::Format_RGBA32FPx4_Premultiplied); break;
+#endif
+    default:
+        break;
+    }
+
+    oiio::TypeDesc format;
+    int nchannels = 0;
+    if(!getResamplePixelLayout(src, format, nchannels))
+        return QImage();
+
+    // the image buffers use the QImage memory: scanlines must not be padded
+    const oiio::ImageSpec srcSpec(src.width(), src.height(), nchannels, format);
+    QImage output(clip.size(), src.format());
+    oiio::ImageSpec dstSpec(clip.width(), clip.height(), nchannels, format);
+    if(output.isNull() || src.bytesPerLine() != qsizetype(srcSpec.scanline_bytes()) || output.bytesPerLine() != qsizetype(dstSpec.scanline_bytes()))
+        return QImage();
+
+    // the full windows of both images are mapped to each other, only the clip region is computed
+    dstSpec.x = clip.x();
+    dstSpec.y = clip.y();
+    dstSpec.full_x = 0;
+    dstSpec.full_y = 0;
+    dstSpec.full_width = outputSize.width();
+    dstSpec.full_height = outputSize.height();
+
+    // constBits: no detach of the source image
+    const oiio::ImageBuf srcBuf(srcSpec, const_cast<uchar*>(src.constBits()));
+    oiio::ImageBuf dstBuf(dstSpec, output.bits());
+    // filter widths are in output pixels: a box of one output pixel averages the source pixels of reductions,
+    // the triangle spans two source pixels on the enlarged axes (bilinear interpolation)
+    const bool reduction = outputSize.width() <= src.width() && outputSize.height() <= src.height();
+    const float ratioX = float(outputSize.width()) / float(src.width());
+    const float ratioY = float(outputSize.height()) / float(src.height());
+    std::unique_ptr<oiio::Filter2D, void (*)(oiio::Filter2D*)> filter(
+        reduction ? oiio::Filter2D::create("box", 1.0f, 1.0f)
+                  : oiio::Filter2D::create("triangle", 2.0f * std::max(1.0f, ratioX), 2.0f * std::max(1.0f, ratioY)),
+        oiio::Filter2D::destroy);
+    if(!filter || !oiio::ImageBufAlgo::resize(dstBuf, srcBuf, filter.get()))
+    {
+        qWarning() << "[QtOIIO] Resample failed: " << dstBuf.geterror().c_str();
+        return QImage();
+    }
+    return output;
+}
+
+/**
+ * @brief Get the path of the file read by a device.
+ * @return the path, or an empty string if the device is not a file on disk (buffer, socket, Qt resource...)
+ */
+QString getDeviceFilePath(QIODevice* device)
 {
-    assert( !(hi < lo) );
-    return (v < lo) ? lo : (hi < v) ? hi : v;
+    QFileDevice* d = dynamic_cast<QFileDevice*>(device);
+    if(!d || d->fileName().isEmpty() || d->fileName().startsWith(':'))
+        return QString();
+    return d->fileName();
 }
 
-inline unsigned short floatToUShort(float v)
+/**
+ * @brief Get the name used to find the OIIO plugin of a device: its file name, or a file name built from the format.
+ */
+std::string getDeviceImageName(QIODevice* device, const QByteArray& format)
 {
-    return clamp(v, 0.0f, 1.0f) * 65535;
+    QFileDevice* d = dynamic_cast<QFileDevice*>(device);
+    if(d && !d->fileName().isEmpty())
+        return d->fileName().toStdString();
+    // the handler format is "OpenImageIO" if canRead() has been called without format
+    if(format.isEmpty() || format.compare("OpenImageIO", Qt::CaseInsensitive) == 0)
+        return "image";
+    return "image." + format.toLower().toStdString();
 }
 
+} // namespace
+
 QtOIIOHandler::QtOIIOHandler()
 {
     qDebug() << "[QtOIIO] QtOIIOHandler";
+    initThreadBudget();
 }
 
 QtOIIOHandler::~QtOIIOHandler()
@@ -40,9 +450,15 @@ QtOIIOHandler::~QtOIIOHandler()
 
 bool QtOIIOHandler::canRead() const
 {
+    // sequential reads stop after the last image of the file
+    syncInputDevice();
+    if(_currentImage > 0 && _currentImage >= imageCount())
+        return false;
     if(canRead(device()))
     {
-        setFormat("OpenImageIO");
+        // keep the format given by the reader: it is the extension hint of the devices without file name
+        if(format().isEmpty())
+            setFormat("OpenImageIO");
         return true;
     }
     return false;
@@ -50,89 +466,381 @@ bool QtOIIOHandler::canRead() const
 
 bool QtOIIOHandler::canRead(QIODevice *device)
 {
-    QFileDevice* d = dynamic_cast<QFileDevice*>(device);
-    if(d)
+    if(!device || !device->isReadable())
+        return false;
+#if OIIO_VERSION >= (10000 * 2 + 100 * 2 + 0) // OIIO_VERSION >= 2.2.0
+    // any device can be read through an IOProxy
+    return true;
+#else
+    // the file is reopened by name
+    return !getDeviceFilePath(device).isEmpty();
+#endif
+}
+
+void QtOIIOHandler::syncInputDevice() const
+{
+    if(_inputDevice == device())
+        return;
+
+    // a new device restarts at the first image
+    _input.reset();
+    _ioProxy.reset();
+    _inputDevice = device();
+    _inputOpened = false;
+    _currentImage = 0;
+    _lastReadImage = 0;
+    _imageCount = 0;
+}
+
+bool QtOIIOHandler::openInput() const
+{
+    // the input stays open for the handler lifetime, unless the device changes
+    syncInputDevice();
+    if(_inputOpened)
+        return _input != nullptr;
+    _inputOpened = true;
+    if(!_inputDevice)
+        return false;
+
+    const QString filePath = getDeviceFilePath(_inputDevice);
+    const std::string name = getDeviceImageName(_inputDevice, format());
+    const oiio::ImageSpec configSpec = getReadConfigSpec();
+
+    // create the input of the format found from the file content, so that OIIO does not try
+    // the plugins one after the other (the extension is only used for unknown signatures)
+    const std::string probedFormat = probeImageFormat(_inputDevice, name);
+    if(!probedFormat.empty())
+        qDebug() << "[QtOIIO] Probed format: " << probedFormat.c_str();
+    const std::string pluginName = probedFormat.empty() ? name : probedFormat;
+    // the probed plugin may not be built in this OIIO: fall back to the plugin of the extension
+    auto createInput = [&]() {
+        std::unique_ptr<oiio::ImageInput> input = oiio::ImageInput::create(pluginName, false, &configSpec);
+        if(!input && pluginName != name)
+        {
+            qDebug() << "[QtOIIO] No OIIO plugin for probed format " << pluginName.c_str() << ", use the extension.";
+            input = oiio::ImageInput::create(name, false, &configSpec);
+        }
+        return input;
+    };
+
+#if OIIO_VERSION >= (10000 * 2 + 100 * 2 + 0) // OIIO_VERSION >= 2.2.0
+    // read through the device, from its current position, if the format supports IO proxies
+    std::unique_ptr<oiio::ImageInput> input = createInput();
+    if(input && input->supports("ioproxy"))
     {
-        // qDebug() << "[QtOIIO] Can read file: " << d->fileName().toStdString();
-        return true;
+        _ioProxy = createDeviceProxy(_inputDevice, input->format_name());
+        input->set_ioproxy(_ioProxy.get());
+        oiio::ImageSpec spec;
+        if(input->open(name, spec, configSpec))
+        {
+            _input = std::move(input);
+        }
+        else
+        {
+            qWarning() << "[QtOIIO] Failed to open image '" << name.c_str() << "' from device: " << input->geterror().c_str();
+            input.reset();
+            _ioProxy.reset();
+        }
     }
-    // qDebug() << "[QtOIIO] Cannot read.";
-    return false;
+#endif
+
+    if(!_input)
+    {
+        // formats without IO proxy support: reopen the file by name
+        if(filePath.isEmpty())
+        {
+            qWarning() << "[QtOIIO] Cannot read image '" << name.c_str() << "' from a device that is not a file.";
+            return false;
+        }
+        std::unique_ptr<oiio::ImageInput> fileInput = createInput();
+        oiio::ImageSpec spec;
+        if(fileInput && fileInput->open(filePath.toStdString(), spec, configSpec))
+            _input = std::move(fileInput);
+        else if(fileInput)
+            qWarning() << "[QtOIIO] " << fileInput->geterror().c_str();
+    }
+    if(!_input)
+    {
+        qWarning() << "[QtOIIO] Failed to open image file '" << name.c_str() << "': " << oiio::geterror().c_str();
+        return false;
+    }
+    // the input opens on the first subimage
+    if(_currentImage > 0)
+        _input->seek_subimage(_currentImage, 0);
+    _spec = _input->spec();
+    return true;
 }
 
 bool QtOIIOHandler::read(QImage *image)
+{
+    syncInputDevice();
+    if(!readCurrentImage(image))
+        return false;
+
+    // sequential reads (QImageReader::read() loops, QMovie) go through the images of the file
+    _lastReadImage = _currentImage;
+    ++_currentImage;
+    if(_input && _input->seek_subimage(_currentImage, 0))
+        _spec = _input->spec();
+    return true;
+}
+
+bool QtOIIOHandler::readCurrentImage(QImage *image)
 {
     bool convertGrayscaleToJetColorMap = true; // how to expose it as an option?
 
     // qDebug() << "[QtOIIO] Read Image";
-    QFileDevice* d = dynamic_cast<QFileDevice*>(device());
-    if(!d)
+    // files on disk are cached and can be read through the shared ImageCache, other devices are only read once
+    const QString filePath = getDeviceFilePath(device());
+    const bool isFile = !filePath.isEmpty();
+    const std::string path = getDeviceImageName(device(), format());
+    QRect clipRect = _clipRect;
+    ReadTrace trace(path);
+
+    // look for an already decoded image, the key covers everything that changes the output
+    const char* colorMapEnv = std::getenv("QTOIIO_COLORMAP");
+    const char* embeddedThumbnailEnv = std::getenv("QTOIIO_EMBEDDED_THUMBNAIL");
+    const char* floatOutputEnv = std::getenv("QTOIIO_FLOAT_OUTPUT");
+    const char* depthRangeEnv = std::getenv("QTOIIO_DEPTH_RANGE");
+    trace.begin("cache_lookup");
+    QtOIIOCache& cache = QtOIIOCache::instance();
+    // background reads (prefetch) do not count in the cache statistics, and store their images themselves;
+    // a disabled cache (no budget) is skipped: no lock, no miss, no file system query
+    const bool useCache = isFile && _useCache && cache.maxBytes() > 0;
+    // sequences: decode the next/previous frames in the background while this one is read
+    SequencePrefetcher* prefetcher = isFile && _prefetchNeighbors && _currentImage == 0 && SequencePrefetcher::instance().enabled() ? &SequencePrefetcher::instance() : nullptr;
+    QtOIIOCache::Key cacheKey;
+    if(useCache || prefetcher)
     {
-        qWarning() << "[QtOIIO] Read image failed (not a FileDevice).";
-        return false;
+        // canonical path: the same file opened through links or relative paths shares its entries
+        const QFileInfo fileInfo(filePath);
+        cacheKey.path = fileInfo.canonicalFilePath();
+        cacheKey.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        cacheKey.subimage = _currentImage;
+        cacheKey.scaledSize = _scaledSize;
+        cacheKey.clipRect = _clipRect;
+        cacheKey.scaledClipRect = _scaledClipRect;
+        cacheKey.conversion = QString("colormap=%1;thumbnail=%2;float=%3;depthrange=%4").arg(QString::fromLocal8Bit(colorMapEnv), QString::fromLocal8Bit(embeddedThumbnailEnv), QString::fromLocal8Bit(floatOutputEnv), QString::fromLocal8Bit(depthRangeEnv));
+    }
+    if(prefetcher)
+        prefetcher->prefetch(cacheKey);
+    if((useCache && cache.find(cacheKey, *image)) || (prefetcher && prefetcher->take(cacheKey, *image)))
+    {
+        // no text keys: the image is shared with the cache, setting them would copy the pixels
+        qDebug() << "[QtOIIO] Cache hit: " << path.c_str();
+        return true;
     }
-    const std::string path = d->fileName().toStdString();
 
     qInfo() << "[QtOIIO] Read image: " << path.c_str();
     // check requested channels number
     // assert(nchannels == 1 || nchannels >= 3);
 
-    oiio::ImageSpec configSpec;
-    // libRAW configuration
-    //configSpec.attribute("raw:user_flip", 0);
-    configSpec.attribute("raw:auto_bright", 0);       // don't want exposure correction
-    configSpec.attribute("raw:use_camera_wb", 1);     // want white balance correction
-#if OIIO_VERSION <= (10000 * 2 + 100 * 0 + 8) // OIIO_VERSION <= 2.0.8
-    // In these previous versions of oiio, there was no Linear option
-    configSpec.attribute("raw:ColorSpace", "sRGB");   // want colorspace sRGB
-#else
-    configSpec.attribute("raw:ColorSpace", "Linear");   // want linear colorspace with sRGB primaries
-#endif    
-    configSpec.attribute("raw:use_camera_matrix", 3); // want to use embeded color profile
+    // files read through the shared ImageCache are opened by the cache only: the spec comes from the cache
+    oiio::ImageCache* imageCache = isFile ? getSharedImageCache() : nullptr;
+    const oiio::ImageSpec configSpec = getReadConfigSpec();
+    oiio::ImageInput* in = nullptr;
+    oiio::ImageBuf inBuf;
+    std::string formatName;
+    if(imageCache)
+    {
+        // rewritten files are read again instead of being served from stale tiles
+        invalidateSharedImageCacheIfModified(filePath.toStdString(), QFileInfo(filePath).lastModified().toMSecsSinceEpoch());
+        trace.begin("open");
+        inBuf.reset(filePath.toStdString(), _currentImage, 0, imageCache, &configSpec);
+        if(!inBuf.init_spec(filePath.toStdString(), _currentImage, 0))
+        {
+            qWarning() << "[QtOIIO] Failed to open image file '" << path.c_str() << "': " << inBuf.geterror().c_str();
+            return false;
+        }
+        formatName = inBuf.file_format_name();
+    }
+    else
+    {
+        // the file is opened once and shared with the option() queries
+        trace.begin("open");
+        if(!openInput())
+            return false;
+        in = _input.get();
+        formatName = in->format_name();
+    }
 
-    oiio::ImageBuf inBuf(path, 0, 0, NULL, &configSpec);
+#if OIIO_VERSION >= (10000 * 2 + 100 * 3 + 0) // OIIO_VERSION >= 2.3.0
+    // for small scaled reads, use the thumbnail embedded in the file if there is a large enough one
+    // (not with the ImageCache, which pages in the small MIP levels instead)
+    const bool useEmbeddedThumbnail = !embeddedThumbnailEnv || std::string(embeddedThumbnailEnv) != "0";
+    if(in && _scaledSize.isValid() && !clipRect.isValid() && useEmbeddedThumbnail && _currentImage == 0)
+    {
+        trace.begin("thumbnail");
+        const QImage thumbnail = readEmbeddedThumbnail(*in, _scaledSize);
+        if(!thumbnail.isNull())
+        {
+            qDebug() << "[QtOIIO] Use embedded thumbnail: " << thumbnail.width() << "x" << thumbnail.height();
+            *image = thumbnail.scaled(_scaledSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            if(_scaledClipRect.isValid())
+                *image = image->copy(_scaledClipRect);
+            trace.annotate(*image);
+            if(useCache)
+                cache.insert(cacheKey, *image);
+            return true;
+        }
+    }
+#endif
 
-    if(!inBuf.initialized())
-        throw std::runtime_error("Can't find/open image file '" + path + "'.");
+    // for a scaled read of a mipmapped file, only decode the smallest sufficient MIP level
+    int miplevel = 0;
+    if(_scaledSize.isValid())
+    {
+        trace.begin("miplevel");
+        const int subimage = _currentImage;
+        if(in)
+        {
+            miplevel = findMipLevelForScaledSize(formatName, [&](int level, oiio::ImageSpec& spec) {
+                if(!in->seek_subimage(subimage, level))
+                    return false;
+                spec = in->spec();
+                return true;
+            }, _scaledSize, clipRect);
+        }
+        else
+        {
+            miplevel = findMipLevelForScaledSize(formatName, [&](int level, oiio::ImageSpec& spec) {
+                if(level >= inBuf.nmiplevels())
+                    return false;
+                return imageCache->get_imagespec(oiio::ustring(filePath.toStdString()), spec, subimage, level);
+            }, _scaledSize, clipRect);
+        }
+        if(miplevel > 0)
+            qDebug() << "[QtOIIO] Read MIP level " << miplevel << " for scaled size.";
+    }
+
+    // copy: the input spec changes when seeking to another subimage/MIP level
+    oiio::ImageSpec inSpec;
+    if(in)
+    {
+        if(!in->seek_subimage(_currentImage, miplevel))
+        {
+            qWarning() << "[QtOIIO] Failed to read image file '" << path.c_str() << "': " << in->geterror().c_str();
+            return false;
+        }
+        inSpec = in->spec();
+    }
+    else
+    {
+        if(miplevel > 0)
+            inBuf.reset(filePath.toStdString(), _currentImage, miplevel, imageCache, &configSpec);
+        if(!inBuf.init_spec(filePath.toStdString(), _currentImage, miplevel))
+        {
+            qWarning() << "[QtOIIO] Failed to read image file '" << path.c_str() << "': " << inBuf.geterror().c_str();
+            return false;
+        }
+        inSpec = inBuf.spec();
+    }
 
 #if OIIO_VERSION <= (10000 * 2 + 100 * 0 + 8) // OIIO_VERSION <= 2.0.8
     // Workaround for bug in RAW colorspace management in previous versions of OIIO:
     //     When asking sRGB we got sRGB primaries with linear gamma,
     //     but oiio::ColorSpace was wrongly set to sRGB.
-    oiio::ImageSpec inSpec = inBuf.spec();
     if(inSpec.get_string_attribute("oiio:ColorSpace", "") == "sRGB")
     {
-        const auto in = oiio::ImageInput::open(path, nullptr);
-        const std::string formatStr = in->format_name();
-        if(formatStr == "raw")
+        if(formatName == "raw")
         {
             // For the RAW plugin: override colorspace as linear (as the content is linear with sRGB primaries but declared as sRGB)
             inSpec.attribute("oiio:ColorSpace", "Linear");
             qDebug() << "OIIO workaround: RAW input image " << QString::fromStdString(path) << " is in Linear.";
         }
     }
-#else
-    const oiio::ImageSpec& inSpec = inBuf.spec();
 #endif
+
+    // region to decode: the whole image or the part intersecting the clip rectangle
+    oiio::ROI readROI = oiio::get_roi(inSpec);
+    if(clipRect.isValid())
+    {
+        readROI = oiio::roi_intersection(readROI,
+            oiio::ROI(readROI.xbegin + clipRect.left(), readROI.xbegin + clipRect.right() + 1,
+                      readROI.ybegin + clipRect.top(), readROI.ybegin + clipRect.bottom() + 1,
+                      readROI.zbegin, readROI.zend, readROI.chbegin, readROI.chend));
+        if(!readROI.defined() || readROI.npixels() == 0)
+        {
+            qWarning() << "[QtOIIO] Clip rectangle is outside of image '" << path.c_str() << "'.";
+            return false;
+        }
+        inSpec.width = readROI.width();
+        inSpec.height = readROI.height();
+        qDebug() << "[QtOIIO] Read region: " << readROI.width() << "x" << readROI.height();
+    }
+
     float pixelAspectRatio = inSpec.get_float_attribute("PixelAspectRatio", 1.0f);
 
     qInfo() << "[QtOIIO] width:" << inSpec.width << ", height:" << inSpec.height << ", nchannels:" << inSpec.nchannels << ", format:" << inSpec.format.c_str();
 
-    if(inSpec.nchannels >= 3)
-    {
-        // Color conversion to sRGB
-        const std::string& colorSpace = inSpec.get_string_attribute("oiio:ColorSpace", "sRGB"); // default image color space is sRGB
+    // Color conversion to sRGB
+    const std::string colorSpace = inSpec.get_string_attribute("oiio:ColorSpace", "sRGB"); // default image color space is sRGB
+    const bool convertColorSpace = inSpec.nchannels >= 3 && colorSpace != "sRGB";
+
+    // 8-bit RGB(A) images without conversion are decoded directly into the QImage memory,
+    // the others are decoded into inBuf first
+    const bool is8Bits = inSpec.format == oiio::TypeDesc::UINT8 || inSpec.format == oiio::TypeDesc::INT8;
+    const bool decodeIntoImage = is8Bits && (inSpec.nchannels == 3 || inSpec.nchannels == 4) &&
+                                 !convertColorSpace && !clipRect.isValid() && !imageCache;
 
-        if(colorSpace != "sRGB") // color conversion to sRGB
+    if(!decodeIntoImage)
+    {
+        trace.begin("decode");
+        bool success = false;
+        if(imageCache)
         {
-            oiio::ImageBufAlgo::colorconvert(inBuf, inBuf, colorSpace, "sRGB");
-            qDebug() << "Convert image " << QString::fromStdString(path) << " from " << QString::fromStdString(colorSpace) << " to sRGB colorspace";
+            // with the shared ImageCache enabled, pixels are paged in from the cache instead of being read in private memory
+            success = inBuf.initialized();
+            if(success && clipRect.isValid())
+            {
+                // a cache-backed buffer only pages in the tiles touched by the cut
+                oiio::ImageBuf regionBuf;
+                success = oiio::ImageBufAlgo::cut(regionBuf, inBuf, readROI);
+                inBuf.swap(regionBuf);
+            }
         }
+        else
+        {
+            success = readImageRegion(*in, _currentImage, miplevel, readROI, inBuf);
+        }
+        if(!success)
+        {
+            qWarning() << "[QtOIIO] Failed to read image file '" << path.c_str() << "'.";
+            return false;
+        }
+    }
+
+    // color conversion to sRGB: the (cached) transform is applied on each row,
+    // fused with the conversion to the QImage format below
+    std::shared_ptr<const ColorTransform> colorTransform;
+    if(convertColorSpace)
+    {
+        colorTransform = ColorTransform::get(colorSpace, "sRGB");
+        if(!colorTransform)
+            return false;
+        qDebug() << "Convert image " << QString::fromStdString(path) << " from " << QString::fromStdString(colorSpace) << " to sRGB colorspace";
     }
 
     int nchannels = 0;
     const bool moreThan8Bits = inSpec.format != oiio::TypeDesc::UINT8 && inSpec.format != oiio::TypeDesc::INT8;
     QImage::Format format = QImage::NImageFormats;
+
+    // half and float RGB(A) images can keep their data (and dynamic range) in floating point Qt images
+    bool floatOutput = false;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    const bool isHalf = inSpec.format == oiio::TypeDesc::HALF;
+    const bool isFloat = inSpec.format == oiio::TypeDesc::FLOAT;
+    floatOutput = floatOutputEnv && std::string(floatOutputEnv) == "1" && (isHalf || isFloat) && (inSpec.nchannels == 3 || inSpec.nchannels == 4);
+    if(floatOutput)
+    {
+        if(inSpec.nchannels == 4)
+            format = isHalf ? QImage::Format_RGBA16FPx4 : QImage::Format_RGBA32FPx4;
+        else
+            format = isHalf ? QImage::Format_RGBX16FPx4 : QImage::Format_RGBX32FPx4;
+        nchannels = 4;
+    }
+    else
+#endif
     if(inSpec.nchannels == 4)
     {
         if(moreThan8Bits)
@@ -181,6 +889,12 @@ bool QtOIIOHandler::read(QImage *image)
             case QImage::Format_RGB32: formatStr = "Format_RGB32"; break;
             case QImage::Format_Grayscale16: formatStr = "Format_Grayscale16"; break;
             case QImage::Format_Grayscale8: formatStr = "Format_Grayscale8"; break;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+            case QImage::Format_RGBA16FPx4: formatStr = "Format_RGBA16FPx4"; break;
+            case QImage::Format_RGBX16FPx4: formatStr = "Format_RGBX16FPx4"; break;
+            case QImage::Format_RGBA32FPx4: formatStr = "Format_RGBA32FPx4"; break;
+            case QImage::Format_RGBX32FPx4: formatStr = "Format_RGBX32FPx4"; break;
+#endif
             default:
                 formatStr = std::string("Unknown QImage Format:") + std::to_string(int(format));
         }
@@ -234,155 +948,342 @@ bool QtOIIOHandler::read(QImage *image)
     // if the input is grayscale, we have the option to convert it with a color map
     if(convertGrayscaleToJetColorMap && inSpec.nchannels == 1)
     {
-        const oiio::TypeDesc typeDesc = oiio::TypeDesc::UINT8;
-        oiio::ImageSpec requestedSpec(inSpec.width, inSpec.height, nchannels, typeDesc);
-        oiio::ImageBuf tmpBuf(requestedSpec);
         // perceptually uniform: "inferno", "viridis", "magma", "plasma" -- others: "blue-red", "spectrum", "heat"
-        const char* colorMapEnv = std::getenv("QTOIIO_COLORMAP");
         const std::string colorMapType = colorMapEnv ? colorMapEnv : "plasma";
 
         // detect AliceVision special files that require a jetColorMap based conversion
-        const bool isDepthMap = d->fileName().contains("depthMap");
-        const bool isNmodMap = d->fileName().contains("nmodMap");
+        const bool isDepthMap = path.find("depthMap") != std::string::npos;
+        const bool isNmodMap = path.find("nmodMap") != std::string::npos;
 
+        // values are converted with: value * scale + offset, then looked up in the color map
+        const ColorMapLut* colorMap = &ColorMapLut::jet();
+        float scale = 1.0f;
+        float offset = 0.0f;
         if(colorMapEnv)
         {
             qDebug() << "[QtOIIO] compute colormap \"" << colorMapType.c_str() << "\"";
-            oiio::ImageBufAlgo::color_map(tmpBuf, inBuf, 0, colorMapType);
+            colorMap = ColorMapLut::named(colorMapType);
+            if(!colorMap)
+            {
+                qWarning() << "[QtOIIO] Unknown colormap \"" << colorMapType.c_str() << "\".";
+                return false;
+            }
         }
         else if(isDepthMap || isNmodMap)
         {
-            oiio::ImageBufAlgo::PixelStats stats;
-            oiio::ImageBufAlgo::computePixelStats(stats, inBuf);
+            // exact or percentile bounds (robust to outliers) in a single parallel pass
+            trace.begin("value_range");
+            ValueRange valueRange;
+            valueRange.compute(inBuf, ValueRange::lowPercentileFromEnv());
 
-#pragma omp parallel for
-            for(int y = 0; y < inSpec.height; ++y)
-            {
-                for(int x = 0; x < inSpec.width; ++x)
-                {
-                    float depthValue = 0.0f;
-                    inBuf.getpixel(x, y, &depthValue, 1);
-                    const float range = stats.max[0] - stats.min[0];
-                    const float normalizedDepthValue = range != 0.0f ? (depthValue - stats.min[0]) / range : 1.0f;
-                    Color32f color;
-                    if(isDepthMap)
-                        color = getColor32fFromJetColorMap(normalizedDepthValue);
-                    else if(isNmodMap)
-                        color = getColor32fFromJetColorMapClamp(normalizedDepthValue);
-                    tmpBuf.setpixel(x, y, color.m, 3); // set only 3 channels (RGB)
-                }
-            }
+            const float range = valueRange.max - valueRange.min;
+            scale = range != 0.0f ? 1.0f / range : 0.0f;
+            offset = range != 0.0f ? -valueRange.min / range : 1.0f;
+            colorMap = isDepthMap ? &ColorMapLut::jet() : &ColorMapLut::jetClamp();
         }
-        else
+
+        // one get_pixels call per scanline (uint16 values are fetched as is), then a row lookup
+        // writing packed 0xffRRGGBB pixels into the QImage
+        trace.begin("colormap");
+        const oiio::ROI roi = inBuf.roi();
+        const bool isUShort = inSpec.format == oiio::TypeDesc::UINT16;
+        const float valueScale = isUShort ? scale / 65535.0f : scale;
+        uchar* dstBits = result.bits();
+        const qsizetype dstBytesPerLine = result.bytesPerLine();
+        parallelRows(inSpec.height, inSpec.width, [&](int ybegin, int yend)
         {
-#pragma omp parallel for
-            for(int y = 0; y < inSpec.height; ++y)
+            std::vector<float> floatRow(isUShort ? 0 : inSpec.width);
+            std::vector<quint16> ushortRow(isUShort ? inSpec.width : 0);
+            for(int y = ybegin; y < yend; ++y)
             {
-                for(int x = 0; x < inSpec.width; ++x)
+                quint32* dst = reinterpret_cast<quint32*>(dstBits + y * dstBytesPerLine);
+                const oiio::ROI rowROI(roi.xbegin, roi.xend, roi.ybegin + y, roi.ybegin + y + 1, roi.zbegin, roi.zbegin + 1, 0, 1);
+                if(isUShort)
+                {
+                    inBuf.get_pixels(rowROI, oiio::TypeDesc::UINT16, ushortRow.data());
+                    colorMap->convertRow(ushortRow.data(), inSpec.width, dst, valueScale, offset);
+                }
+                else
                 {
-                    float depthValue = 0.0f;
-                    inBuf.getpixel(x, y, &depthValue, 1);
-                    Color32f color = getColor32fFromJetColorMap(depthValue);
-                    tmpBuf.setpixel(x, y, color.m, 3); // set only 3 channels (RGB)
+                    inBuf.get_pixels(rowROI, oiio::TypeDesc::FLOAT, floatRow.data());
+                    colorMap->convertRow(floatRow.data(), inSpec.width, dst, valueScale, offset);
                 }
             }
-        }
-        // qDebug() << "[QtOIIO] compute colormap done";
-        inBuf.swap(tmpBuf);
-
-        {
-            oiio::ROI exportROI = inBuf.roi();
-            exportROI.chbegin = 0;
-            exportROI.chend = nchannels;
-
-            // qDebug() << "[QtOIIO] fill output QImage";
-            inBuf.get_pixels(exportROI, typeDesc, result.bits());
-        }
+        });
     }
 
     // Shuffle channels to convert from OIIO to Qt
     else if(nchannels == 4)
     {
-        const oiio::TypeDesc typeDesc = moreThan8Bits ? oiio::TypeDesc::UINT16 : oiio::TypeDesc::UINT8;
-
-        if(moreThan8Bits) // same than: format == QImage::Format_RGBA64 || format == QImage::Format_RGBX64
+        if(floatOutput) // same than: format is one of the QImage::Format_RGB(A|X)(16|32)FPx4
+        {
+            qDebug() << "[QtOIIO] Copy '" << inSpec.format.c_str() << "'' OIIO image to floating point Qt image.";
+            trace.begin("convert_float");
+            // half/float data are copied as is (no clamping), one get_pixels call per scanline,
+            // color converted rows go through a float row buffer
+            const oiio::ROI roi = inBuf.roi();
+            const int srcChannels = inSpec.nchannels;
+            const oiio::TypeDesc dstType = inSpec.format;
+            const oiio::stride_t dstPixelStride = 4 * dstType.size();
+            uchar* dstBits = result.bits();
+            const qsizetype dstBytesPerLine = result.bytesPerLine();
+            parallelRows(inSpec.height, inSpec.width, [&](int ybegin, int yend)
+            {
+                std::vector<float> floatRow(colorTransform ? inSpec.width * srcChannels : 0);
+                for(int y = ybegin; y < yend; ++y)
+                {
+                    uchar* dst = dstBits + y * dstBytesPerLine;
+                    const oiio::ROI rowROI(roi.xbegin, roi.xend, roi.ybegin + y, roi.ybegin + y + 1, roi.zbegin, roi.zbegin + 1, 0, srcChannels);
+                    if(colorTransform)
+                    {
+                        inBuf.get_pixels(rowROI, oiio::TypeDesc::FLOAT, floatRow.data());
+                        colorTransform->apply(floatRow.data(), inSpec.width, srcChannels, false);
+                        oiio::convert_image(srcChannels, inSpec.width, 1, 1,
+                                            floatRow.data(), oiio::TypeDesc::FLOAT, srcChannels * sizeof(float), oiio::AutoStride, oiio::AutoStride,
+                                            dst, dstType, dstPixelStride, oiio::AutoStride, oiio::AutoStride);
+                    }
+                    else
+                    {
+                        inBuf.get_pixels(rowROI, dstType, dst, dstPixelStride);
+                    }
+                    if(srcChannels == 3)
+                    {
+                        if(dstType == oiio::TypeDesc::HALF)
+                            fillRowAlphaRgba16F(reinterpret_cast<quint16*>(dst), inSpec.width);
+                        else
+                            fillRowAlphaRgba32F(reinterpret_cast<float*>(dst), inSpec.width);
+                    }
+                }
+            });
+        }
+        else if(moreThan8Bits) // same than: format == QImage::Format_RGBA64 || format == QImage::Format_RGBX64
         {
             qDebug() << "[QtOIIO] Convert '" << inSpec.format.c_str() << "'' OIIO image to 'uint16' Qt image.";
-#pragma omp parallel for
-            for(int y = 0; y < inSpec.height; ++y)
+            trace.begin("convert_rgba64");
+            // Convert row by row: each scanline is fetched in a single get_pixels call
+            // (uint16 data without color conversion is copied as is, other types are fetched as float),
+            // then color converted, clamped, scaled and interleaved into the QImage scanline.
+            const oiio::ROI roi = inBuf.roi();
+            const int srcChannels = std::min(inSpec.nchannels, 4);
+            const bool isUShort = inSpec.format == oiio::TypeDesc::UINT16 && !colorTransform;
+            const oiio::stride_t dstPixelStride = 4 * sizeof(quint16);
+            uchar* dstBits = result.bits();
+            const qsizetype dstBytesPerLine = result.bytesPerLine();
+            parallelRows(inSpec.height, inSpec.width, [&](int ybegin, int yend)
             {
-                for(int x = 0; x < inSpec.width; ++x)
+                std::vector<float> floatRow(isUShort ? 0 : inSpec.width * srcChannels);
+                for(int y = ybegin; y < yend; ++y)
                 {
-                    float rgba[4] = {0.0, 0.0, 0.0, 1.0};
-                    inBuf.getpixel(x, y, rgba, 4);
-
-                    quint64* p = (quint64*)(result.scanLine(y)) + x;
-                    QRgba64 color = QRgba64::fromRgba64(floatToUShort(rgba[0]), floatToUShort(rgba[1]), floatToUShort(rgba[2]), floatToUShort(rgba[3]));
-                    *p = (quint64)color;
+                    quint16* dst = reinterpret_cast<quint16*>(dstBits + y * dstBytesPerLine);
+                    const oiio::ROI rowROI(roi.xbegin, roi.xend, roi.ybegin + y, roi.ybegin + y + 1, roi.zbegin, roi.zbegin + 1, 0, srcChannels);
+                    if(isUShort)
+                    {
+                        inBuf.get_pixels(rowROI, oiio::TypeDesc::UINT16, dst, dstPixelStride);
+                        if(srcChannels == 3)
+                            fillRowAlphaRgba64(dst, inSpec.width);
+                    }
+                    else
+                    {
+                        inBuf.get_pixels(rowROI, oiio::TypeDesc::FLOAT, floatRow.data());
+                        if(colorTransform)
+                            colorTransform->apply(floatRow.data(), inSpec.width, srcChannels, true);
+                        convertRowFloatToRgba64(floatRow.data(), srcChannels, dst, inSpec.width);
+                    }
                 }
-            }
+            });
         }
         else
         {
-            oiio::ImageSpec requestedSpec(inSpec.width, inSpec.height, nchannels, typeDesc);
-            oiio::ImageBuf tmpBuf(requestedSpec);
-            // qDebug() << "[QtOIIO] shuffle channels";
-
-            std::vector<int> channelOrder = {0, 1, 2, 3};
-            float channelValues[] = {1.f, 1.f, 1.f, 1.f};
-            if(format == QImage::Format_ARGB32)
+            // RGBA bytes are written directly into the QImage memory (4 bytes per pixel),
+            // then swizzled in place to the (A)RGB32 layout expected by Qt.
+            const int srcChannels = std::min(inSpec.nchannels, 4);
+            uchar* dstBits = result.bits();
+            const qsizetype dstBytesPerLine = result.bytesPerLine();
+            bool success = false;
+            if(colorTransform)
             {
-                // (0xAARRGGBB) => 3, 0, 1, 2 in reverse order
-                channelOrder = {2, 1, 0, 3};
+                // color converted rows go through a float row buffer, quantized to (A)RGB32
+                trace.begin("convert_argb32");
+                const oiio::ROI roi = inBuf.roi();
+                parallelRows(inSpec.height, inSpec.width, [&](int ybegin, int yend)
+                {
+                    std::vector<float> floatRow(inSpec.width * srcChannels);
+                    for(int y = ybegin; y < yend; ++y)
+                    {
+                        quint32* dst = reinterpret_cast<quint32*>(dstBits + y * dstBytesPerLine);
+                        const oiio::ROI rowROI(roi.xbegin, roi.xend, roi.ybegin + y, roi.ybegin + y + 1, roi.zbegin, roi.zbegin + 1, 0, srcChannels);
+                        inBuf.get_pixels(rowROI, oiio::TypeDesc::FLOAT, floatRow.data());
+                        colorTransform->apply(floatRow.data(), inSpec.width, srcChannels, true);
+                        convertRowFloatToArgb32(floatRow.data(), srcChannels, dst, inSpec.width);
+                    }
+                });
+                success = true;
             }
-            else if(format == QImage::Format_RGB32)
+            else if(decodeIntoImage)
             {
-                channelOrder = {2, 1, 0, -1}; // not sure
+                // decode straight into the QImage, without allocating the ImageBuf pixels
+                qDebug() << "[QtOIIO] Decode 8-bit image into the Qt image.";
+                trace.begin("decode");
+                success = in->read_image(0, srcChannels, oiio::TypeDesc::UINT8, dstBits, 4, dstBytesPerLine);
             }
             else
             {
-                qWarning() << "Unsupported format conversion.";
-            }
-            // qWarning() << "channelOrder: " << channelOrder[0] << ", " << channelOrder[1] << ", " << channelOrder[2] << ", " << channelOrder[3];
-            oiio::ImageBufAlgo::channels(tmpBuf, inBuf, 4, &channelOrder.front(), channelValues, {}, false);
-            inBuf.swap(tmpBuf);
-            // qDebug() << "[QtOIIO] shuffle channels done";
-
-            {
+                trace.begin("convert_rgba8");
                 oiio::ROI exportROI = inBuf.roi();
                 exportROI.chbegin = 0;
-                exportROI.chend = nchannels;
+                exportROI.chend = srcChannels;
+                success = inBuf.get_pixels(exportROI, oiio::TypeDesc::UINT8, dstBits, 4, dstBytesPerLine);
+            }
+            if(!success)
+            {
+                qWarning() << "[QtOIIO] Failed to read pixels of image '" << path.c_str() << "'.";
+                return false;
+            }
 
-                // qDebug() << "[QtOIIO] fill output QImage";
-                inBuf.get_pixels(exportROI, typeDesc, result.bits());
+            if(!colorTransform)
+            {
+                trace.begin("swizzle");
+                const bool opaque = srcChannels == 3;
+                parallelRows(inSpec.height, inSpec.width, [&](int ybegin, int yend)
+                {
+                    for(int y = ybegin; y < yend; ++y)
+                    {
+                        quint32* row = reinterpret_cast<quint32*>(dstBits + y * dstBytesPerLine);
+                        swizzleRowRgba8ToArgb32(row, inSpec.width, opaque);
+                    }
+                });
             }
         }
     }
 
 
-    if (pixelAspectRatio != 1.0f)
+    // display size: the pixel aspect ratio is applied, then the image is fitted in the scaled size
+    QSize outputSize(inSpec.width * pixelAspectRatio, inSpec.height);
+    if(_scaledSize.isValid())
     {
-        QSize newSize(inSpec.width * pixelAspectRatio, inSpec.height);
-        result = result.scaled(newSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        qDebug() << "[QTOIIO] _scaledSize: " << _scaledSize.width() << "x" << _scaledSize.height();
+        outputSize = outputSize.scaled(_scaledSize, Qt::KeepAspectRatio);
     }
 
-    // qDebug() << "[QtOIIO] Image loaded: \"" << path << "\"";
-    if (_scaledSize.isValid())
+    // pixel aspect ratio, scaled size and scaled clip rect in a single resample pass
+    bool resampled = false;
+    if(outputSize != result.size())
     {
-        qDebug() << "[QTOIIO] _scaledSize: " << _scaledSize.width() << "x" << _scaledSize.height();
-        *image = result.scaled(_scaledSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        trace.begin("resample");
+        QImage output = resampleImage(result, outputSize, _scaledClipRect);
+        if(!output.isNull())
+        {
+            *image = std::move(output);
+            resampled = true;
+        }
     }
-    else
+
+    if(!resampled)
     {
-        *image = result;
+        // formats not supported by the resample (or nothing to resample): resize with Qt
+        if(outputSize != result.size())
+        {
+            trace.begin("scaled_resize");
+            *image = result.scaled(outputSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        else
+        {
+            // moved: the trace text keys must not detach (copy) a shared image
+            *image = std::move(result);
+        }
+
+        if(_scaledClipRect.isValid())
+        {
+            trace.begin("scaled_clip");
+            *image = image->copy(_scaledClipRect);
+        }
     }
+
+    trace.annotate(*image);
+    if(useCache)
+        cache.insert(cacheKey, *image);
     return true;
 }
 
 bool QtOIIOHandler::write(const QImage &image)
 {
-    // TODO
-    return false;
+    QFileDevice* d = dynamic_cast<QFileDevice*>(device());
+    if(!d)
+    {
+        qWarning() << "[QtOIIO] Write image failed (not a FileDevice).";
+        return false;
+    }
+    const std::string path = d->fileName().toStdString();
+
+    // the output plugin is chosen from the requested format, or from the file extension
+    std::unique_ptr<oiio::ImageOutput> out;
+    if(!format().isEmpty())
+        out = oiio::ImageOutput::create(format().toStdString());
+    if(!out)
+        out = oiio::ImageOutput::create(path);
+    if(!out)
+    {
+        qWarning() << "[QtOIIO] No OIIO output for image file '" << path.c_str() << "': " << oiio::geterror().c_str();
+        return false;
+    }
+
+    QImage outImage = image;
+    oiio::TypeDesc pixelFormat;
+    int nchannels = 0;
+    oiio::stride_t xstride = 0;
+    getOutputPixelLayout(outImage, pixelFormat, nchannels, xstride);
+
+    oiio::ImageSpec spec(outImage.width(), outImage.height(), nchannels, pixelFormat);
+    spec.attribute("oiio:ColorSpace", "sRGB");
+    if(outImage.dotsPerMeterX() > 0 && outImage.dotsPerMeterY() > 0)
+    {
+        spec.attribute("XResolution", outImage.dotsPerMeterX() / 100.0f);
+        spec.attribute("YResolution", outImage.dotsPerMeterY() / 100.0f);
+        spec.attribute("ResolutionUnit", "cm");
+    }
+    if(_quality >= 0)
+        spec.attribute("CompressionQuality", _quality);
+    if(_compressionRatio >= 0.0f)
+    {
+        // lossless compression on/off, only for the formats where it is a choice (like Qt's TIFF handler:
+        // 0 means no compression), other formats keep their own compression settings
+        const std::string outFormat = out->format_name();
+        const bool compress = _compressionRatio > 0.0f;
+        if(outFormat == "tiff")
+            spec.attribute("compression", compress ? "lzw" : "none");
+        else if(outFormat == "openexr")
+            spec.attribute("compression", compress ? "zip" : "none");
+        else if(outFormat == "targa" || outFormat == "sgi")
+            spec.attribute("compression", compress ? "rle" : "none");
+    }
+    if(_subType == "tiled")
+    {
+        if(out->supports("tiles"))
+        {
+            spec.tile_width = 64;
+            spec.tile_height = 64;
+            spec.tile_depth = 1;
+        }
+        else
+        {
+            qWarning() << "[QtOIIO] Format '" << out->format_name() << "' does not support tiled output, write scanlines.";
+        }
+    }
+
+    if(!out->open(path, spec))
+    {
+        qWarning() << "[QtOIIO] Failed to open image file '" << path.c_str() << "' for writing: " << out->geterror().c_str();
+        return false;
+    }
+
+    // a single call reading the QImage scanlines in place (with its strides), so that the output
+    // can convert and compress the whole image with its threads (OpenEXR chunks, tiles...)
+    qInfo() << "[QtOIIO] Write image: " << path.c_str();
+    bool success = out->write_image(pixelFormat, outImage.constBits(), xstride, outImage.bytesPerLine());
+    if(!success)
+        qWarning() << "[QtOIIO] Failed to write image file '" << path.c_str() << "': " << out->geterror().c_str();
+    success = out->close() && success;
+    return success;
 }
 
 bool QtOIIOHandler::supportsOption(ImageOption option) const
@@ -393,40 +1294,41 @@ bool QtOIIOHandler::supportsOption(ImageOption option) const
         return true;
     if(option == ScaledSize)
         return true;
+    if(option == ClipRect)
+        return true;
+    if(option == ScaledClipRect)
+        return true;
+    if(option == Animation)
+        return true;
+    if(option == Quality)
+        return true;
+    if(option == CompressionRatio)
+        return true;
+    if(option == SubType)
+        return true;
+    if(option == SupportedSubTypes)
+        return true;
 
     return false;
 }
 
 QVariant QtOIIOHandler::option(ImageOption option) const
 {
-    const auto getImageInput = [](QIODevice* device) -> std::unique_ptr<oiio::ImageInput> {
-        QFileDevice* d = dynamic_cast<QFileDevice*>(device);
-        if(!d)
-        {
-            qDebug() << "[QtOIIO] Read image failed (not a FileDevice).";
-            return std::unique_ptr<oiio::ImageInput>(nullptr);
-        }
-        std::string path = d->fileName().toStdString();
-        return std::unique_ptr<oiio::ImageInput>(oiio::ImageInput::open(path));
-    };
-
     if (option == Size)
     {
-        std::unique_ptr<oiio::ImageInput> imageInput = getImageInput(device());
-        if(imageInput.get() == nullptr)
+        if(!openInput())
             return QVariant();
 
-        return QSize(imageInput->spec().width, imageInput->spec().height);
+        return QSize(_spec.width, _spec.height);
     }
     else if(option == ImageTransformation)
     {
-        std::unique_ptr<oiio::ImageInput> imageInput = getImageInput(device());
-        if(imageInput.get() == nullptr)
+        if(!openInput())
         {
             return QImageIOHandler::TransformationNone;
         }
         // Translate OIIO transformations to QImageIOHandler::ImageTransformation
-        switch(oiio::ImageBuf(imageInput->spec()).orientation())
+        switch(_spec.get_int_attribute("Orientation", 1))
         {
         case 1: return QImageIOHandler::TransformationNone; break;
         case 2: return QImageIOHandler::TransformationMirror; break;
@@ -438,6 +1340,20 @@ QVariant QtOIIOHandler::option(ImageOption option) const
         case 8: return QImageIOHandler::TransformationRotate270; break;
         }
     }
+    else if(option == Animation)
+    {
+        // only the formats storing a frame rate are animations (GIF, WebP), not the layers of
+        // a multipart EXR or the pages of a TIFF
+        return imageCount() > 1 && _spec.find_attribute("FramesPerSecond") != nullptr;
+    }
+    else if(option == SubType)
+    {
+        return _subType;
+    }
+    else if(option == SupportedSubTypes)
+    {
+        return QVariant::fromValue(QList<QByteArray>{"scanline", "tiled"});
+    }
     return QImageIOHandler::option(option);
 }
 
@@ -450,6 +1366,89 @@ void QtOIIOHandler::setOption(ImageOption option, const QVariant &value)
         _scaledSize = value.value<QSize>();
         qDebug() << "[QTOIIO] setOption scaledSize: " << _scaledSize.width() << "x" << _scaledSize.height();
     }
+    else if (option == ClipRect && value.isValid())
+    {
+        _clipRect = value.toRect();
+    }
+    else if (option == ScaledClipRect && value.isValid())
+    {
+        _scaledClipRect = value.toRect();
+    }
+    else if (option == Quality && value.isValid())
+    {
+        _quality = value.toInt();
+    }
+    else if (option == CompressionRatio && value.isValid())
+    {
+        _compressionRatio = value.toFloat();
+    }
+    else if (option == SubType && value.isValid())
+    {
+        _subType = value.toByteArray().toLower();
+    }
+}
+
+int QtOIIOHandler::imageCount() const
+{
+    if(!openInput())
+        return 0;
+    if(_imageCount > 0)
+        return _imageCount;
+
+    // count the subimages by seeking through them (only the headers are read), then go back to the current one
+    int count = 1;
+    while(_input->seek_subimage(count, 0))
+        ++count;
+    _input->seek_subimage(_currentImage, 0);
+    _imageCount = count;
+    return _imageCount;
+}
+
+bool QtOIIOHandler::jumpToImage(int imageNumber)
+{
+    if(!openInput() || imageNumber < 0)
+        return false;
+    if(imageNumber == _currentImage)
+        return imageNumber < imageCount();
+
+    // seek in the opened file, without reopening it
+    if(!_input->seek_subimage(imageNumber, 0))
+    {
+        _input->seek_subimage(_currentImage, 0);
+        return false;
+    }
+    _currentImage = imageNumber;
+    _spec = _input->spec();
+    qDebug() << "[QtOIIO] Jump to image " << _currentImage;
+    return true;
+}
+
+bool QtOIIOHandler::jumpToNextImage()
+{
+    return jumpToImage(_currentImage + 1);
+}
+
+int QtOIIOHandler::currentImageNumber() const
+{
+    return _lastReadImage;
+}
+
+int QtOIIOHandler::nextImageDelay() const
+{
+    if(!openInput())
+        return 0;
+
+    // animated formats store their frame rate as a rational (GIF, WebP...) or a float
+    const oiio::ParamValue* framesPerSecond = _spec.find_attribute("FramesPerSecond");
+    if(!framesPerSecond)
+        return 0;
+    if(framesPerSecond->type() == oiio::TypeRational)
+    {
+        const int* fps = static_cast<const int*>(framesPerSecond->data());
+        return fps[0] > 0 ? int(1000ll * fps[1] / fps[0]) : 0;
+    }
+    const float fps = _spec.get_float_attribute("FramesPerSecond", 0.0f);
+    return fps > 0.0f ? int(1000.0f / fps) : 0;
 }
 
 QByteArray QtOIIOHandler::name() const
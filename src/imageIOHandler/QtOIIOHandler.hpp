@@ -2,6 +2,11 @@
 #include <QImageIOHandler>
 #include <QImage>
 
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/filesystem.h>
+
+#include <memory>
+
 class QtOIIOHandler : public QImageIOHandler
 {
 public:
@@ -20,5 +25,51 @@ public:
     void setOption(ImageOption option, const QVariant &value);
     bool supportsOption(ImageOption option) const;
 
+    // multi-image files (multipart EXR, multi-page TIFF, animated GIF...): one image per OIIO subimage
+    int imageCount() const;
+    bool jumpToImage(int imageNumber);
+    bool jumpToNextImage();
+    int currentImageNumber() const;
+    int nextImageDelay() const;
+
     QSize _scaledSize;
+    QRect _clipRect;
+    QRect _scaledClipRect;
+    // write options (-1: OIIO default)
+    int _quality = -1;
+    float _compressionRatio = -1.0f;
+    QByteArray _subType;
+    /// look up and store the decoded images in the process-wide cache (disabled for the prefetch reads)
+    bool _useCache = true;
+    /// prefetch the neighboring frames of numbered sequences (disabled for the prefetch reads themselves)
+    bool _prefetchNeighbors = true;
+
+private:
+    /// Read the current image of the file (read() then moves to the next one)
+    bool readCurrentImage(QImage *image);
+
+    /// Close the input and restart at the first image if the device has changed
+    void syncInputDevice() const;
+
+    /**
+     * @brief Open the image of the current device, if not already opened.
+     *        The input is kept open and shared by option() and read().
+     * @return true if the input is open
+     */
+    bool openInput() const;
+
+    /// device reader of the input (declared first: it must outlive the input)
+    mutable std::unique_ptr<OIIO::Filesystem::IOProxy> _ioProxy;
+    mutable std::unique_ptr<OIIO::ImageInput> _input;
+    mutable QIODevice* _inputDevice = nullptr;
+    /// true once the input of _inputDevice has been opened (or failed to open)
+    mutable bool _inputOpened = false;
+    /// spec of the current subimage at full resolution
+    mutable OIIO::ImageSpec _spec;
+    /// current subimage (the next one read), reset to 0 when the device changes
+    mutable int _currentImage = 0;
+    /// last subimage read, returned by currentImageNumber()
+    mutable int _lastReadImage = 0;
+    /// number of subimages, counted on demand (0 if not counted yet)
+    mutable int _imageCount = 0;
 };
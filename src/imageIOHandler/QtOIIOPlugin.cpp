@@ -1,5 +1,10 @@
 #include "QtOIIOPlugin.hpp"
 #include "QtOIIOHandler.hpp"
+#include "QtOIIOCache.hpp"
+#include "formatProbe.hpp"
+#include "formatRouting.hpp"
+
+#include "../sharedImageCache.hpp"
 
 #include <QImageIOHandler>
 #include <QFileDevice>
@@ -13,69 +18,105 @@ namespace oiio = OIIO;
 
 QtOIIOPlugin::QtOIIOPlugin()
 {
-    qDebug() << "[QtOIIO] init supported extensions.";
-
-    std::string extensionsListStr;
-    oiio::getattribute("extension_list", extensionsListStr);
+    // OIIO is initialized on the first capabilities query: loading the plugin stays cheap
+}
 
-    QString extensionsListQStr(QString::fromStdString(extensionsListStr));
+const QSet<QByteArray>& QtOIIOPlugin::supportedExtensions() const
+{
+    std::call_once(_supportedExtensionsInit, [this]() {
+        // "format1:ext1,ext2;format2:ext3..."
+        std::string extensionsListStr;
+        oiio::getattribute("extension_list", extensionsListStr);
 
-    QStringList formats = extensionsListQStr.split(';');
-    for(auto& format: formats)
-    {
-        qDebug() << "[QtOIIO] format: " << format << ".";
-        QStringList keyValues = format.split(":");
-        if(keyValues.size() != 2)
+        const QByteArray extensionsList = QByteArray::fromStdString(extensionsListStr).toLower();
+        for(const QByteArray& format : extensionsList.split(';'))
         {
-            qDebug() << "[QtOIIO] warning: split OIIO keys: " << keyValues.size() << " for " << format << ".";
+            const QList<QByteArray> keyValues = format.split(':');
+            if(keyValues.size() != 2)
+            {
+                qDebug() << "[QtOIIO] warning: split OIIO keys: " << keyValues.size() << " for " << format << ".";
+                continue;
+            }
+            const QList<QByteArray> extensions = keyValues[1].split(',');
+            _formatExtensions.insert(keyValues[0], extensions);
+            for(const QByteArray& extension : extensions)
+                _supportedExtensions.insert(extension);
         }
-        else
-        {
-            _supportedExtensions += keyValues[1].split(",");
-        }
-    }
-    qDebug() << "[QtOIIO] supported extensions: " << _supportedExtensions.join(", ");
-    qInfo() << "[QtOIIO] Plugin Initialized";
+        qDebug() << "[QtOIIO] supported extensions: " << _supportedExtensions.size();
+        qInfo() << "[QtOIIO] Plugin Initialized";
+    });
+    return _supportedExtensions;
+}
+
+const QHash<QByteArray, QList<QByteArray>>& QtOIIOPlugin::formatExtensions() const
+{
+    supportedExtensions();
+    return _formatExtensions;
 }
 
 QtOIIOPlugin::~QtOIIOPlugin()
 {
+    // nothing to report if no image has been handled
+    if(!_used)
+        return;
+
+    const QtOIIOCache& cache = QtOIIOCache::instance();
+    qInfo() << "[QtOIIO] Cache hits:" << cache.hits() << ", misses:" << cache.misses();
+
+    const std::string imageCacheStats = getSharedImageCacheStats();
+    if(!imageCacheStats.empty())
+        qInfo().noquote() << "[QtOIIO] ImageCache statistics:\n" << QString::fromStdString(imageCacheStats);
 }
 
 QImageIOPlugin::Capabilities QtOIIOPlugin::capabilities(QIODevice *device, const QByteArray &format) const
 {
-    QFileDevice* d = dynamic_cast<QFileDevice*>(device);
-    if(!d)
+    // the routing calibration times Qt's own decoders
+    if(!device || FormatRouting::isCalibrationThread())
         return QImageIOPlugin::Capabilities();
 
-    const std::string path = d->fileName().toStdString();
+    // files are read by name with OIIO < 2.2, other devices (buffers, Qt resources...) need IO proxies
+    QFileDevice* d = dynamic_cast<QFileDevice*>(device);
+    const std::string path = d ? d->fileName().toStdString() : std::string();
+#if OIIO_VERSION < (10000 * 2 + 100 * 2 + 0) // OIIO_VERSION < 2.2.0
     if(path.empty() || path[0] == ':')
         return QImageIOPlugin::Capabilities();
+#endif
 
-#ifdef QTOIIO_USE_FORMATS_BLACKLIST
-    // For performance sake, let Qt handle natively some formats.
-    static const QStringList blacklist{"jpeg", "jpg", "png", "ico"};
-    if(blacklist.contains(format, Qt::CaseSensitivity::CaseInsensitive))
+    // formats routed to Qt's native decoders
+    FormatRouting& routing = FormatRouting::instance();
+    routing.calibrateOnce();
+    if(routing.decoder(format) == FormatRouting::Decoder::Qt)
     {
         return QImageIOPlugin::Capabilities();
     }
-#endif
-    if (_supportedExtensions.contains(format, Qt::CaseSensitivity::CaseInsensitive))
+    if (supportedExtensions().contains(format.toLower()))
     {
         qDebug() << "[QtOIIO] Capabilities: extension \"" << QString(format) << "\" supported.";
-//        oiio::ImageOutput *out = oiio::ImageOutput::create(path); // TODO: when writting will be implemented
         Capabilities capabilities(CanRead);
-//        if(out)
-//            capabilities = Capabilities(CanRead|CanWrite);
-//        oiio::ImageOutput::destroy(out);
+        // only look for an output plugin when the device is opened for writing
+        if(device->isWritable() && !path.empty() && oiio::ImageOutput::create(path))
+            capabilities |= CanWrite;
         return capabilities;
     }
+    // unknown or missing extension: look for a known signature in the first bytes
+    if(device->isReadable())
+    {
+        // the probe returns OIIO format names ("tiff", "jpeg", "openexr"), routing keys are extensions
+        const QByteArray probedFormat = QByteArray::fromStdString(probeImageFormat(device, path));
+        if(!probedFormat.isEmpty() &&
+           routing.decoderOfFormatName(probedFormat, formatExtensions().value(probedFormat)) == FormatRouting::Decoder::OIIO)
+        {
+            qDebug() << "[QtOIIO] Capabilities: content of format \"" << probedFormat << "\" supported.";
+            return Capabilities(CanRead);
+        }
+    }
     qDebug() << "[QtOIIO] Capabilities: extension \"" << QString(format) << "\" not supported";
     return QImageIOPlugin::Capabilities();
 }
 
 QImageIOHandler *QtOIIOPlugin::create(QIODevice *device, const QByteArray &format) const
 {
+    _used = true;
     QtOIIOHandler *handler = new QtOIIOHandler;
     handler->setDevice(device);
     handler->setFormat(format);
@@ -2,8 +2,14 @@
 
 #include <qimageiohandler.h>
 #include <QtCore/QtGlobal>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 
 // QImageIOHandlerFactoryInterface_iid
 
@@ -14,14 +20,27 @@ public:
     Q_OBJECT
     Q_PLUGIN_METADATA(IID "org.qt-project.Qt.QImageIOHandlerFactoryInterface" FILE "QtOIIOPlugin.json")
 
-public:
-    QStringList _supportedExtensions;
-
 public:
     QtOIIOPlugin();
     ~QtOIIOPlugin();
 
     Capabilities capabilities(QIODevice *device, const QByteArray &format) const;
     QImageIOHandler *create(QIODevice *device, const QByteArray &format = QByteArray()) const;
+
+private:
+    /**
+     * @brief Get the (lower case) extensions supported by OIIO.
+     *        OIIO is only queried on the first call, not when the plugin is loaded.
+     */
+    const QSet<QByteArray>& supportedExtensions() const;
+
+    /// Get the (lower case) extensions of each OIIO format plugin, e.g. "tiff": ["tif", "tiff", "tx", ...]
+    const QHash<QByteArray, QList<QByteArray>>& formatExtensions() const;
+
+    mutable std::once_flag _supportedExtensionsInit;
+    mutable QSet<QByteArray> _supportedExtensions;
+    mutable QHash<QByteArray, QList<QByteArray>> _formatExtensions;
+    /// true once a handler has been created
+    mutable std::atomic<bool> _used{false};
 };
 
@@ -0,0 +1,151 @@
+#include "colorTransform.hpp"
+
+#include <QDebug>
+
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace oiio = OIIO;
+
+std::shared_ptr<const ColorTransform> ColorTransform::get(const std::string& from, const std::string& to)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<std::string, std::string>, std::shared_ptr<const ColorTransform>> transforms;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto key = std::make_pair(from, to);
+    const auto it = transforms.find(key);
+    if(it != transforms.end())
+        return it->second;
+
+    // the color configuration ($OCIO or OIIO built-in color spaces) is loaded once
+    static const oiio::ColorConfig colorConfig;
+    oiio::ColorProcessorHandle processor = colorConfig.createColorProcessor(from, to);
+    std::shared_ptr<const ColorTransform> transform;
+    if(processor)
+        transform.reset(new ColorTransform(processor));
+    else
+        qWarning() << "[QtOIIO] Cannot create color conversion from " << from.c_str() << " to " << to.c_str() << ": " << colorConfig.geterror().c_str();
+
+    transforms.emplace(key, transform);
+    return transform;
+}
+
+ColorTransform::ColorTransform(OIIO::ColorProcessorHandle processor)
+    : _processor(processor)
+{
+    if(_processor->hasChannelCrosstalk())
+        return;
+
+    // sample the transform on [0, 1] for each channel
+    _lut.resize(3 * lutSize);
+    for(int i = 0; i < lutSize; ++i)
+    {
+        const float v = float(i) / float(lutSize - 1);
+        _lut[3 * i + 0] = v;
+        _lut[3 * i + 1] = v;
+        _lut[3 * i + 2] = v;
+    }
+    _processor->apply(_lut.data(), lutSize, 1, 3, sizeof(float), 3 * sizeof(float), 3 * lutSize * sizeof(float));
+
+    // clamping the inputs is only exact if the outputs of out of range inputs are clamped to the same bounds:
+    // the transform must be monotonic, map 0 (and below) to <= 0 and 1 (and above) to >= 1
+    const float epsilon = 1e-5f;
+    std::vector<float> outside = {-16.0f, -1.0f, -0.25f, 1.25f, 2.0f, 16.0f};
+    const std::size_t below = 3; // number of values below 0
+    std::vector<float> outsideRgb;
+    for(float v : outside)
+        outsideRgb.insert(outsideRgb.end(), {v, v, v});
+    _processor->apply(outsideRgb.data(), int(outside.size()), 1, 3, sizeof(float), 3 * sizeof(float), 3 * outside.size() * sizeof(float));
+
+    _lutBounded = true;
+    for(int c = 0; c < 3 && _lutBounded; ++c)
+    {
+        _lutBounded = _lut[c] <= epsilon && _lut[3 * (lutSize - 1) + c] >= 1.0f - epsilon;
+        for(int i = 1; i < lutSize && _lutBounded; ++i)
+            _lutBounded = _lut[3 * i + c] >= _lut[3 * (i - 1) + c];
+        for(std::size_t i = 0; i < outside.size() && _lutBounded; ++i)
+        {
+            const float v = outsideRgb[3 * i + c];
+            _lutBounded = i < below ? v <= epsilon : v >= 1.0f - epsilon;
+        }
+    }
+    if(!_lutBounded)
+        qDebug() << "[QtOIIO] Color transform not bounded: out of range values go through the processor.";
+}
+
+void ColorTransform::apply(float* row, int width, int nchannels, bool unitRange) const
+{
+    // like ImageBufAlgo::colorconvert (unpremult=true): convert the color of unpremultiplied pixels
+    const bool premultiplied = nchannels == 4;
+    if(premultiplied)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            float* p = row + x * 4;
+            const float alpha = p[3];
+            if(alpha != 0.0f)
+            {
+                p[0] /= alpha;
+                p[1] /= alpha;
+                p[2] /= alpha;
+            }
+        }
+    }
+
+    if(!unitRange || _lut.empty())
+        applyProcessor(row, width, nchannels);
+    else
+        applyLut(row, width, nchannels);
+
+    if(premultiplied)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            float* p = row + x * 4;
+            const float alpha = p[3];
+            if(alpha != 0.0f)
+            {
+                p[0] *= alpha;
+                p[1] *= alpha;
+                p[2] *= alpha;
+            }
+        }
+    }
+}
+
+void ColorTransform::applyProcessor(float* row, int width, int nchannels) const
+{
+    _processor->apply(row, width, 1, nchannels, sizeof(float), nchannels * sizeof(float), width * nchannels * sizeof(float));
+}
+
+void ColorTransform::applyLut(float* row, int width, int nchannels) const
+{
+    // linear interpolation in the lookup tables, inputs clamped to [0, 1] (NaN is mapped to 0)
+    const float* lut = _lut.data();
+    for(int x = 0; x < width; ++x)
+    {
+        float* p = row + x * nchannels;
+        // clamping is exact for bounded transforms, unless the pixel is premultiplied again by an alpha in (0, 1)
+        const bool clampExact = _lutBounded && (nchannels < 4 || p[3] == 0.0f || p[3] >= 1.0f);
+        if(!clampExact && !(p[0] >= 0.0f && p[0] <= 1.0f && p[1] >= 0.0f && p[1] <= 1.0f && p[2] >= 0.0f && p[2] <= 1.0f))
+        {
+            // out of the sampled range (or NaN): exact transform of this pixel
+            applyProcessor(p, 1, nchannels);
+            continue;
+        }
+        for(int c = 0; c < 3; ++c)
+        {
+            float v = p[c] > 0.0f ? p[c] : 0.0f;
+            v = v < 1.0f ? v : 1.0f;
+            const float f = v * float(lutSize - 1);
+            int i = static_cast<int>(f);
+            i = i < lutSize - 2 ? i : lutSize - 2;
+            const float t = f - float(i);
+            const float a = lut[3 * i + c];
+            const float b = lut[3 * (i + 1) + c];
+            p[c] = a + t * (b - a);
+        }
+    }
+}
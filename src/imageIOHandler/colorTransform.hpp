@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <OpenImageIO/color.h>
+
+/**
+ * @brief Color space conversion applied on rows of float pixels.
+ *
+ * Transforms are created once per color space pair and cached for the process lifetime.
+ * Transforms without channel crosstalk (e.g. Linear to sRGB, which only changes the
+ * transfer function) are sampled into per-channel lookup tables, used when the result is
+ * quantized to integers afterwards. The other transforms apply the OIIO color processor.
+ * The lookup tables clamp their inputs to [0, 1]: values out of this range go through the
+ * processor, unless the transform is known to keep them out of [0, 1] (monotonic, 0 and 1 mapped
+ * outside or on the bounds) and the pixel is not premultiplied by a partial alpha afterwards,
+ * where clamping before or after the transform gives the same result.
+ * Like ImageBufAlgo::colorconvert, RGBA pixels are unpremultiplied before the conversion
+ * and premultiplied again afterwards.
+ */
+class ColorTransform
+{
+public:
+    /**
+     * @brief Get the cached transform between two color spaces.
+     * @return the transform, or nullptr if it cannot be created
+     */
+    static std::shared_ptr<const ColorTransform> get(const std::string& from, const std::string& to);
+
+    /**
+     * @brief Convert a row of interleaved float pixels in place. Only the first 3 channels are converted.
+     * @param[in,out] row pixels (width * nchannels values)
+     * @param[in] width number of pixels
+     * @param[in] nchannels number of channels (3 or 4, the 4th channel is a premultiplied alpha)
+     * @param[in] unitRange true if the result is only used in [0, 1] (clamped integer output),
+     *            which allows the lookup table path
+     */
+    void apply(float* row, int width, int nchannels, bool unitRange) const;
+
+    /// true if the lookup table path is used for unit range outputs
+    bool hasLut() const { return !_lut.empty(); }
+
+private:
+    /// number of entries of the lookup tables, sampling [0, 1]
+    static const int lutSize = 4097;
+
+    explicit ColorTransform(OIIO::ColorProcessorHandle processor);
+
+    void applyProcessor(float* row, int width, int nchannels) const;
+    void applyLut(float* row, int width, int nchannels) const;
+
+    OIIO::ColorProcessorHandle _processor;
+    /// per-channel lookup tables (3 * lutSize values), empty if the transform has channel crosstalk
+    std::vector<float> _lut;
+    /// true if the values out of [0, 1] can be clamped before the lookup (see class description)
+    bool _lutBounded = false;
+};
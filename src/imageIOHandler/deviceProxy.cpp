@@ -0,0 +1,141 @@
+#include "deviceProxy.hpp"
+
+#if OIIO_VERSION >= (10000 * 2 + 100 * 2 + 0) // OIIO_VERSION >= 2.2.0
+
+#include <QBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QFileDevice>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+namespace oiio = OIIO;
+
+namespace {
+
+bool useMemoryMapping(const std::string& formatName)
+{
+    // opt-in: a mapped file truncated while it is read (files rewritten in place) raises SIGBUS
+    const char* mmapEnv = std::getenv("QTOIIO_MMAP");
+    if(!mmapEnv || std::string(mmapEnv) != "1")
+        return false;
+    // formats where the decoder mostly copies the file data: compressed formats (JPEG, PNG...)
+    // read their data once into the decompressor, mapping them does not save anything
+    static const char* const mappedFormats[] = {"dpx", "pfm", "pnm", "bmp", "tiff", "openexr", "targa", "sgi"};
+    return std::find(std::begin(mappedFormats), std::end(mappedFormats), formatName) != std::end(mappedFormats);
+}
+
+/**
+ * @brief IOMemReader over the data of a QBuffer, kept alive by sharing the QByteArray.
+ */
+class ByteArrayReader : public oiio::Filesystem::IOMemReader
+{
+public:
+    ByteArrayReader(const QByteArray& data, qint64 origin)
+        : oiio::Filesystem::IOMemReader(const_cast<char*>(data.constData()) + origin, size_t(data.size() - origin))
+        , _data(data)
+    {
+    }
+
+private:
+    const QByteArray _data;
+};
+
+/**
+ * @brief IOMemReader over a memory-mapped file, the mapping is owned by the reader.
+ */
+class MappedFileReader : public oiio::Filesystem::IOMemReader
+{
+public:
+    MappedFileReader(std::unique_ptr<QFile> file, uchar* data, qint64 size)
+        : oiio::Filesystem::IOMemReader(data, size_t(size))
+        , _file(std::move(file))
+    {
+    }
+
+    const char* proxytype() const override { return "qtoiio_mmap"; }
+
+private:
+    /// the mapping is released when the file is closed
+    std::unique_ptr<QFile> _file;
+};
+
+} // namespace
+
+QIODeviceProxy::QIODeviceProxy(QIODevice* device)
+    : oiio::Filesystem::IOProxy("", Read)
+    , _device(device)
+    , _origin(device->isSequential() ? 0 : device->pos())
+{
+    if(_device->isSequential())
+        _sequentialData = _device->readAll();
+}
+
+bool QIODeviceProxy::opened() const
+{
+    return _device->isReadable();
+}
+
+size_t QIODeviceProxy::read(void* buf, size_t size)
+{
+    // streaming readers: read at the proxy position, then move it
+    const size_t count = pread(buf, size, tell());
+    seek(tell() + int64_t(count));
+    return count;
+}
+
+size_t QIODeviceProxy::pread(void* buf, size_t size, int64_t offset)
+{
+    if(_device->isSequential())
+    {
+        if(offset < 0 || offset >= _sequentialData.size())
+            return 0;
+        const size_t count = std::min(size, size_t(_sequentialData.size() - offset));
+        std::memcpy(buf, _sequentialData.constData() + offset, count);
+        return count;
+    }
+
+    QMutexLocker lock(&_mutex);
+    if(!_device->seek(_origin + offset))
+        return 0;
+    const qint64 count = _device->read(static_cast<char*>(buf), qint64(size));
+    return count > 0 ? size_t(count) : 0;
+}
+
+size_t QIODeviceProxy::size() const
+{
+    const qint64 deviceSize = _device->isSequential() ? _sequentialData.size() : _device->size() - _origin;
+    return deviceSize > 0 ? size_t(deviceSize) : 0;
+}
+
+std::unique_ptr<oiio::Filesystem::IOProxy> createDeviceProxy(QIODevice* device, const std::string& formatName)
+{
+    if(QBuffer* buffer = qobject_cast<QBuffer*>(device))
+    {
+        // decode the buffer memory in place
+        return std::unique_ptr<oiio::Filesystem::IOProxy>(new ByteArrayReader(buffer->data(), buffer->pos()));
+    }
+    QFileDevice* fileDevice = qobject_cast<QFileDevice*>(device);
+    if(fileDevice && !fileDevice->isSequential() && !fileDevice->fileName().isEmpty() && useMemoryMapping(formatName))
+    {
+        // map the file: the decoder reads the data straight from the page cache, without buffered read calls.
+        // The file is opened again: QImageReader deletes its device before the handler (and its input).
+        const qint64 origin = fileDevice->pos();
+        std::unique_ptr<QFile> file(new QFile(fileDevice->fileName()));
+        const qint64 mappedSize = file->open(QIODevice::ReadOnly) ? file->size() - origin : 0;
+        if(mappedSize > 0)
+        {
+            if(uchar* data = file->map(origin, mappedSize))
+                return std::unique_ptr<oiio::Filesystem::IOProxy>(new MappedFileReader(std::move(file), data, mappedSize));
+        }
+        qDebug() << "[QtOIIO] Cannot map file '" << fileDevice->fileName() << "', read it through the device.";
+    }
+    return std::unique_ptr<oiio::Filesystem::IOProxy>(new QIODeviceProxy(device));
+}
+
+#endif
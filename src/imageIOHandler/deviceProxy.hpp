@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/filesystem.h>
+
+#include <memory>
+
+#if OIIO_VERSION >= (10000 * 2 + 100 * 2 + 0) // OIIO_VERSION >= 2.2.0
+
+/**
+ * @brief OIIO IOProxy reading a QIODevice.
+ *
+ * Offsets are relative to the position of the device when the proxy is created,
+ * so an image stored after a header (or in the middle of a stream) can be decoded.
+ * Sequential devices (sockets, pipes...) cannot seek: their remaining data is read at once.
+ */
+class QIODeviceProxy : public OIIO::Filesystem::IOProxy
+{
+public:
+    explicit QIODeviceProxy(QIODevice* device);
+
+    const char* proxytype() const override { return "qiodevice"; }
+    bool opened() const override;
+    size_t read(void* buf, size_t size) override;
+    size_t pread(void* buf, size_t size, int64_t offset) override;
+    size_t size() const override;
+
+private:
+    QIODevice* _device;
+    const qint64 _origin;
+    /// data of a sequential device
+    QByteArray _sequentialData;
+    /// pread may be called concurrently, but the device has a single position
+    QMutex _mutex;
+};
+
+/**
+ * @brief Create the IOProxy used to decode an image from a device, from its current position.
+ *        QBuffer data is read in place (without copy, the data is shared with the buffer).
+ *        When the QTOIIO_MMAP environment variable is set to 1, files of uncompressed or lightly
+ *        compressed formats are memory-mapped. The proxy maps its own handle of the file, so the
+ *        mapping stays valid after the device is deleted.
+ *        Other devices are read through QIODeviceProxy.
+ * @param[in] formatName name of the OIIO plugin decoding the image
+ */
+std::unique_ptr<OIIO::Filesystem::IOProxy> createDeviceProxy(QIODevice* device, const std::string& formatName);
+
+#endif
@@ -0,0 +1,87 @@
+#include "formatProbe.hpp"
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QString>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+bool startsWith(const QByteArray& header, const char* magic, int size, int offset = 0)
+{
+    return header.size() >= offset + size && std::memcmp(header.constData() + offset, magic, size) == 0;
+}
+
+/// RAW formats stored in a TIFF container
+bool isTiffBasedRawExtension(const QString& extension)
+{
+    static const char* rawExtensions[] = {
+        "3fr", "arw", "cr2", "dcr", "dng", "erf", "fff", "iiq", "k25", "kdc", "mdc", "mef", "mos",
+        "nef", "nrw", "pef", "ptx", "raw", "rwl", "sr2", "srf", "srw"
+    };
+    return std::any_of(std::begin(rawExtensions), std::end(rawExtensions),
+                       [&](const char* rawExtension) { return extension == QLatin1String(rawExtension); });
+}
+
+} // namespace
+
+std::string probeImageFormat(QIODevice* device, const std::string& name)
+{
+    if(!device || !device->isReadable())
+        return std::string();
+
+    const QByteArray header = device->peek(32);
+    const QString extension = QFileInfo(QString::fromStdString(name)).suffix().toLower();
+
+    if(startsWith(header, "\x76\x2f\x31\x01", 4))
+        return "openexr";
+    if(startsWith(header, "II*\0", 4) || startsWith(header, "MM\0*", 4) ||  // TIFF
+       startsWith(header, "II+\0", 4) || startsWith(header, "MM\0+", 4))    // BigTIFF
+        return isTiffBasedRawExtension(extension) ? "raw" : "tiff";
+    if(startsWith(header, "\x89PNG\r\n\x1a\n", 8))
+        return "png";
+    if(startsWith(header, "\xff\xd8\xff", 3))
+        return "jpeg";
+    if(startsWith(header, "SDPX", 4) || startsWith(header, "XPDS", 4))
+        return "dpx";
+    if(startsWith(header, "\x80\x2a\x5f\xd7", 4) || startsWith(header, "\xd7\x5f\x2a\x80", 4))
+        return "cineon";
+    if(startsWith(header, "#?RADIANCE", 10) || startsWith(header, "#?RGBE", 6))
+        return "hdr";
+    if(header.size() >= 3 && header[0] == 'P' && std::memchr("123456fF", header[1], 8) && std::isspace(static_cast<unsigned char>(header[2])))
+        return "pnm"; // PNM and PFM
+    if(startsWith(header, "GIF87a", 6) || startsWith(header, "GIF89a", 6))
+        return "gif";
+    if(startsWith(header, "8BPS", 4))
+        return "psd";
+    if(startsWith(header, "RIFF", 4) && startsWith(header, "WEBP", 4, 8))
+        return "webp";
+    if(startsWith(header, "\0\0\0\x0cjP  \r\n\x87\n", 12) || startsWith(header, "\xff\x4f\xff\x51", 4))
+        return "jpeg2000";
+    if(startsWith(header, "SIMPLE  =", 9))
+        return "fits";
+    if(startsWith(header, "\x01\xda", 2))
+        return "sgi";
+    if(startsWith(header, "ftyp", 4, 4))
+    {
+        // ISO base media files: Canon CR3 or HEIF/AVIF
+        if(startsWith(header, "crx ", 4, 8))
+            return "raw";
+        if(startsWith(header, "heic", 4, 8) || startsWith(header, "heix", 4, 8) || startsWith(header, "mif1", 4, 8) ||
+           startsWith(header, "msf1", 4, 8) || startsWith(header, "avif", 4, 8))
+            return "heif";
+    }
+    // RAW formats with their own signature (Canon CRW, Fujifilm RAF, Olympus ORF, Panasonic RW2)
+    if(startsWith(header, "HEAPCCDR", 8, 6) || startsWith(header, "FUJIFILM", 8) ||
+       startsWith(header, "IIRO", 4) || startsWith(header, "IIRS", 4) || startsWith(header, "MMOR", 4) ||
+       startsWith(header, "IIU\0", 4))
+        return "raw";
+    if(startsWith(header, "BM", 2) && extension == "bmp")
+        return "bmp";
+
+    return std::string();
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QIODevice>
+
+#include <string>
+
+/**
+ * @brief Find the OIIO format plugin of an image from the magic number in its first bytes.
+ *
+ * The bytes are peeked, the device position is unchanged. TIFF based RAW files share the TIFF
+ * signature: they are told apart by the extension of the name.
+ * @param[in] device opened device, at the beginning of the image
+ * @param[in] name file name of the image (only used for its extension), can be empty
+ * @return the OIIO format name (e.g. "openexr", "tiff", "raw"), or an empty string if unknown
+ */
+std::string probeImageFormat(QIODevice* device, const std::string& name);
@@ -0,0 +1,221 @@
+#include "formatRouting.hpp"
+#include "QtOIIOHandler.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QMap>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <cstdlib>
+
+namespace {
+
+const char* decoderName(FormatRouting::Decoder decoder)
+{
+    return decoder == FormatRouting::Decoder::Qt ? "qt" : "oiio";
+}
+
+/// set while the current thread runs the calibration
+thread_local bool calibrationThread = false;
+
+} // namespace
+
+/**
+ * @brief Calibration of the routing table, in a thread of the global pool.
+ */
+class CalibrationJob : public QRunnable
+{
+public:
+    CalibrationJob(FormatRouting& routing, const QString& samplesDirectory)
+        : routing(routing)
+        , samplesDirectory(samplesDirectory)
+    {
+    }
+
+    void run() override
+    {
+        calibrationThread = true;
+        routing.calibrate(samplesDirectory);
+        calibrationThread = false;
+    }
+
+    FormatRouting& routing;
+    const QString samplesDirectory;
+};
+
+FormatRouting& FormatRouting::instance()
+{
+    static FormatRouting routing;
+    return routing;
+}
+
+FormatRouting::FormatRouting()
+{
+#ifdef QTOIIO_USE_FORMATS_BLACKLIST
+    // For performance sake, let Qt handle natively some formats.
+    parse("jpeg=qt,jpg=qt,png=qt,ico=qt");
+#endif
+
+    if(const char* routingFileEnv = std::getenv("QTOIIO_ROUTING_FILE"))
+    {
+        QFile routingFile(QString::fromLocal8Bit(routingFileEnv));
+        if(routingFile.open(QIODevice::ReadOnly))
+            qDebug() << "[QtOIIO] Routing file entries: " << parse(routingFile.readAll());
+    }
+    if(const char* routingEnv = std::getenv("QTOIIO_ROUTING"))
+        parse(routingEnv);
+}
+
+int FormatRouting::parse(const QByteArray& entries)
+{
+    int count = 0;
+    QByteArray normalized = entries.toLower();
+    normalized.replace(';', '\n').replace(',', '\n');
+    for(const QByteArray& line : normalized.split('\n'))
+    {
+        const QByteArray entry = line.trimmed();
+        if(entry.isEmpty() || entry.startsWith('#'))
+            continue;
+        const QList<QByteArray> keyValue = entry.split('=');
+        const QByteArray decoder = keyValue.size() == 2 ? keyValue[1].trimmed() : QByteArray();
+        if(decoder != "qt" && decoder != "oiio")
+        {
+            qWarning() << "[QtOIIO] Invalid routing entry: " << entry;
+            continue;
+        }
+        setDecoder(keyValue[0].trimmed(), decoder == "qt" ? Decoder::Qt : Decoder::OIIO);
+        ++count;
+    }
+    return count;
+}
+
+void FormatRouting::setDecoder(const QByteArray& format, Decoder decoder)
+{
+    QMutexLocker lock(&_mutex);
+    _decoders.insert(format, decoder);
+}
+
+FormatRouting::Decoder FormatRouting::decoder(const QByteArray& format) const
+{
+    QMutexLocker lock(&_mutex);
+    return _decoders.value(format.toLower(), Decoder::OIIO);
+}
+
+FormatRouting::Decoder FormatRouting::decoderOfFormatName(const QByteArray& formatName, const QList<QByteArray>& extensions) const
+{
+    QMutexLocker lock(&_mutex);
+    if(_decoders.value(formatName.toLower(), Decoder::OIIO) == Decoder::Qt)
+        return Decoder::Qt;
+    for(const QByteArray& extension : extensions)
+    {
+        if(_decoders.value(extension.toLower(), Decoder::OIIO) == Decoder::Qt)
+            return Decoder::Qt;
+    }
+    return Decoder::OIIO;
+}
+
+bool FormatRouting::isCalibrationThread()
+{
+    return calibrationThread;
+}
+
+void FormatRouting::calibrateOnce()
+{
+    // called on every capabilities query: the environment is only read on the first one
+    std::call_once(_calibrationInit, [this]() {
+        const char* calibrateEnv = std::getenv("QTOIIO_CALIBRATE");
+        if(!calibrateEnv)
+            return;
+        // off the query path: the calibration decodes every sample twice
+        QThreadPool::globalInstance()->start(new CalibrationJob(*this, QString::fromLocal8Bit(calibrateEnv)));
+    });
+}
+
+void FormatRouting::calibrate(const QString& samplesDirectory)
+{
+    qInfo() << "[QtOIIO] Calibrate decoders routing on " << samplesDirectory;
+
+    // total decode time per extension, in nanoseconds
+    QMap<QByteArray, qint64> qtTimes;
+    QMap<QByteArray, qint64> oiioTimes;
+
+    const QFileInfoList samples = QDir(samplesDirectory).entryInfoList(QDir::Files, QDir::Name);
+    for(const QFileInfo& sample : samples)
+    {
+        const QByteArray extension = sample.suffix().toLower().toUtf8();
+        if(extension.isEmpty() || qtTimes.value(extension, 0) < 0)
+            continue;
+
+        QFile file(sample.absoluteFilePath());
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+        file.readAll(); // same conditions for both decoders: the file is in the page cache
+        file.seek(0);
+
+        // Qt: the plugin declines all formats in this thread, content sniffing cannot fall back to OIIO
+        QElapsedTimer timer;
+        timer.start();
+        QImageReader reader(sample.absoluteFilePath());
+        const bool qtSuccess = !reader.read().isNull();
+        const qint64 qtTime = timer.nsecsElapsed();
+        if(!qtSuccess)
+        {
+            qDebug() << "[QtOIIO] Calibration: no Qt decoder for " << extension;
+            qtTimes[extension] = -1;
+            continue;
+        }
+
+        // OIIO: read through a handler created directly
+        QtOIIOHandler handler;
+        handler.setDevice(&file);
+        // time the decode of this sample only: no cached image, no background decodes of numbered neighbors
+        handler._prefetchNeighbors = false;
+        handler._useCache = false;
+        QImage image;
+        timer.restart();
+        const bool oiioSuccess = handler.read(&image);
+        const qint64 oiioTime = timer.nsecsElapsed();
+        if(!oiioSuccess)
+        {
+            qDebug() << "[QtOIIO] Calibration: OIIO cannot read " << sample.fileName();
+            continue;
+        }
+
+        qtTimes[extension] += qtTime;
+        oiioTimes[extension] += oiioTime;
+    }
+
+    for(auto it = oiioTimes.constBegin(); it != oiioTimes.constEnd(); ++it)
+    {
+        const qint64 qtTime = qtTimes.value(it.key());
+        const Decoder fastest = qtTime < it.value() ? Decoder::Qt : Decoder::OIIO;
+        setDecoder(it.key(), fastest);
+        qInfo() << "[QtOIIO] Calibration: " << it.key() << ": Qt " << qtTime / 1000000.0 << "ms, OIIO "
+                << it.value() / 1000000.0 << "ms -> " << decoderName(fastest);
+    }
+
+    if(const char* routingFileEnv = std::getenv("QTOIIO_ROUTING_FILE"))
+        save(QString::fromLocal8Bit(routingFileEnv));
+}
+
+bool FormatRouting::save(const QString& routingFile) const
+{
+    QFile file(routingFile);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qWarning() << "[QtOIIO] Cannot write routing file " << routingFile;
+        return false;
+    }
+    QMutexLocker lock(&_mutex);
+    file.write("# QtOIIO decoders routing: extension=qt|oiio\n");
+    for(auto it = _decoders.constBegin(); it != _decoders.constEnd(); ++it)
+        file.write(it.key() + "=" + decoderName(it.value()) + "\n");
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+#include <mutex>
+
+class CalibrationJob;
+
+/**
+ * @brief Runtime table of the formats (extensions) decoded by Qt's native plugins instead of OIIO.
+ *
+ * The table is built from, by increasing priority:
+ *  - the default table: jpeg, jpg, png and ico are left to Qt if QTOIIO_USE_FORMATS_BLACKLIST is defined,
+ *  - the routing file set by the QTOIIO_ROUTING_FILE environment variable,
+ *  - the QTOIIO_ROUTING environment variable.
+ * Entries are written "extension=qt" or "extension=oiio", separated by new lines, ',' or ';'.
+ *
+ * If QTOIIO_CALIBRATE is set to a directory of sample images, both decoders are timed on these
+ * files in a background thread started by the first capabilities query, and the faster one is kept
+ * for each extension (and saved to the routing file, if set). The table is only updated with
+ * the results: queries made during the calibration use the table as configured.
+ */
+class FormatRouting
+{
+public:
+    enum class Decoder
+    {
+        OIIO,
+        Qt
+    };
+
+    /// Process-wide instance
+    static FormatRouting& instance();
+
+    /// Decoder of a format, OIIO if the format is not in the table
+    Decoder decoder(const QByteArray& format) const;
+
+    /**
+     * @brief Decoder of an OIIO format plugin (e.g. "tiff", "openexr" found by probeImageFormat).
+     * @param[in] formatName OIIO format name
+     * @param[in] extensions extensions of the format (the routing keys)
+     * @return Qt if the format name or one of its extensions is routed to Qt, OIIO otherwise
+     */
+    Decoder decoderOfFormatName(const QByteArray& formatName, const QList<QByteArray>& extensions) const;
+
+    /// Start the calibration once in the background if requested by QTOIIO_CALIBRATE (read on the first call only)
+    void calibrateOnce();
+
+    /// true in the calibration thread: the plugin declines all formats so that images are decoded by Qt
+    static bool isCalibrationThread();
+
+private:
+    friend class CalibrationJob;
+
+    FormatRouting();
+
+    /// Parse routing entries, return the number of valid entries
+    int parse(const QByteArray& entries);
+    void setDecoder(const QByteArray& format, Decoder decoder);
+    /// Time both decoders on the samples, then update the table (run in the calibration thread)
+    void calibrate(const QString& samplesDirectory);
+    bool save(const QString& routingFile) const;
+
+    mutable QMutex _mutex;
+    QHash<QByteArray, Decoder> _decoders;
+    std::once_flag _calibrationInit;
+};
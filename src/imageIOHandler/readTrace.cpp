@@ -0,0 +1,114 @@
+#include "readTrace.hpp"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+bool textKeysEnabled()
+{
+    static const bool enabled = []() {
+        const char* traceEnv = std::getenv("QTOIIO_TRACE");
+        return traceEnv && std::string(traceEnv) == "1";
+    }();
+    return enabled;
+}
+
+const char* traceFilePath()
+{
+    static const char* path = std::getenv("QTOIIO_TRACE_FILE");
+    return path;
+}
+
+std::int64_t nowMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QString escapeJson(const std::string& str)
+{
+    QString escaped = QString::fromStdString(str);
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return escaped;
+}
+
+} // namespace
+
+ReadTrace::ReadTrace(const std::string& imageName)
+    : _enabled(textKeysEnabled() || traceFilePath())
+{
+    if(!_enabled)
+        return;
+    _imageName = imageName;
+    _start = nowMicroseconds();
+}
+
+ReadTrace::~ReadTrace()
+{
+    if(!_enabled)
+        return;
+    end();
+    if(traceFilePath())
+        writeTraceEvents();
+}
+
+void ReadTrace::begin(const char* stage)
+{
+    if(!_enabled)
+        return;
+    end();
+    _currentStage = stage;
+    _currentStart = nowMicroseconds();
+}
+
+void ReadTrace::end()
+{
+    if(!_enabled || !_currentStage)
+        return;
+    _events.push_back({_currentStage, _currentStart, nowMicroseconds() - _currentStart});
+    _currentStage = nullptr;
+}
+
+void ReadTrace::annotate(QImage& image)
+{
+    if(!_enabled)
+        return;
+    end();
+    if(!textKeysEnabled() || image.isNull())
+        return;
+    for(const Event& event : _events)
+        image.setText(QString("QtOIIO:%1").arg(event.stage), QString::number(event.duration / 1000.0, 'f', 3));
+    image.setText("QtOIIO:total", QString::number((nowMicroseconds() - _start) / 1000.0, 'f', 3));
+}
+
+void ReadTrace::writeTraceEvents() const
+{
+    // JSON array format, without the closing bracket (optional for trace viewers) so that events can be appended
+    const qint64 pid = QCoreApplication::applicationPid();
+    const quint64 tid = quint64(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    const QString imageName = escapeJson(_imageName);
+    QString json;
+    json += QString("{\"name\":\"read\",\"cat\":\"QtOIIO\",\"ph\":\"X\",\"ts\":%1,\"dur\":%2,\"pid\":%3,\"tid\":%4,\"args\":{\"image\":\"%5\"}},\n")
+                .arg(_start).arg(nowMicroseconds() - _start).arg(pid).arg(tid).arg(imageName);
+    for(const Event& event : _events)
+    {
+        json += QString("{\"name\":\"%1\",\"cat\":\"QtOIIO\",\"ph\":\"X\",\"ts\":%2,\"dur\":%3,\"pid\":%4,\"tid\":%5,\"args\":{\"image\":\"%6\"}},\n")
+                    .arg(event.stage).arg(event.start).arg(event.duration).arg(pid).arg(tid).arg(imageName);
+    }
+
+    static QMutex mutex;
+    QMutexLocker lock(&mutex);
+    QFile file(QString::fromLocal8Bit(traceFilePath()));
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return;
+    if(file.size() == 0)
+        file.write("[\n");
+    file.write(json.toUtf8());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Timings of the stages of an image read, switched on at runtime.
+ *
+ * Stages are sequential: starting a stage ends the previous one.
+ * When the QTOIIO_TRACE environment variable is set to 1, the stage durations are attached to
+ * the decoded QImage as text keys ("QtOIIO:<stage>" in milliseconds, and "QtOIIO:total").
+ * When QTOIIO_TRACE_FILE is set, the stages are also appended to this file as Chrome trace events
+ * (chrome://tracing, Perfetto).
+ * When both are unset, the timers cost a boolean check.
+ */
+class ReadTrace
+{
+public:
+    explicit ReadTrace(const std::string& imageName);
+    ~ReadTrace();
+
+    bool enabled() const { return _enabled; }
+
+    /// End the current stage (if any) and start a new one (name must be a string literal)
+    void begin(const char* stage);
+    /// End the current stage
+    void end();
+    /**
+     * @brief End the current stage and attach the stage durations to an image as text keys.
+     *        Call it before the image is shared (e.g. inserted in the cache) to avoid a deep copy.
+     */
+    void annotate(QImage& image);
+
+private:
+    struct Event
+    {
+        const char* stage;
+        std::int64_t start; // microseconds
+        std::int64_t duration; // microseconds
+    };
+
+    void writeTraceEvents() const;
+
+    const bool _enabled;
+    std::string _imageName;
+    std::int64_t _start = 0;
+    const char* _currentStage = nullptr;
+    std::int64_t _currentStart = 0;
+    std::vector<Event> _events;
+};
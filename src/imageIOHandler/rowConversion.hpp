@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QtEndian>
+
+// Row kernels used to fill QImage scanlines from OIIO pixel rows.
+// They are written as plain loops over contiguous memory, without branches
+// on the pixel values, so that the compiler can auto-vectorize them.
+
+inline quint16 floatToUShort(float v)
+{
+    // clamp to [0, 1] (NaN is mapped to 0)
+    v = v > 0.0f ? v : 0.0f;
+    v = v < 1.0f ? v : 1.0f;
+    return static_cast<quint16>(v * 65535.0f);
+}
+
+inline quint8 floatToUChar(float v)
+{
+    // clamp to [0, 1] (NaN is mapped to 0)
+    v = v > 0.0f ? v : 0.0f;
+    v = v < 1.0f ? v : 1.0f;
+    return static_cast<quint8>(v * 255.0f + 0.5f);
+}
+
+/**
+ * @brief Convert a row of interleaved float pixels to a 32-bit (A)RGB row (0xAARRGGBB).
+ * @param[in] src input row (width * srcChannels values)
+ * @param[in] srcChannels number of channels of the input row (3 or 4)
+ * @param[out] dst output row, alpha is set to opaque for 3 channels inputs
+ * @param[in] width number of pixels in the row
+ */
+inline void convertRowFloatToArgb32(const float* src, int srcChannels, quint32* dst, int width)
+{
+    for(int x = 0; x < width; ++x)
+    {
+        const float* p = src + x * srcChannels;
+        const quint32 a = srcChannels == 4 ? floatToUChar(p[3]) : 0xffu;
+        dst[x] = (a << 24) | (quint32(floatToUChar(p[0])) << 16) | (quint32(floatToUChar(p[1])) << 8) | quint32(floatToUChar(p[2]));
+    }
+}
+
+/**
+ * @brief Convert a row of interleaved float pixels to a 64-bit halfword-ordered RGBA row.
+ * @param[in] src input row (width * srcChannels values)
+ * @param[in] srcChannels number of channels of the input row (3 or 4)
+ * @param[out] dst output row (width * 4 values), alpha is set to opaque for 3 channels inputs
+ * @param[in] width number of pixels in the row
+ */
+inline void convertRowFloatToRgba64(const float* src, int srcChannels, quint16* dst, int width)
+{
+    if(srcChannels == 4)
+    {
+        const int size = width * 4;
+        for(int i = 0; i < size; ++i)
+            dst[i] = floatToUShort(src[i]);
+    }
+    else
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            dst[4 * x + 0] = floatToUShort(src[3 * x + 0]);
+            dst[4 * x + 1] = floatToUShort(src[3 * x + 1]);
+            dst[4 * x + 2] = floatToUShort(src[3 * x + 2]);
+            dst[4 * x + 3] = 65535;
+        }
+    }
+}
+
+/**
+ * @brief Set the alpha channel of a 64-bit halfword-ordered RGBA row to opaque.
+ */
+inline void fillRowAlphaRgba64(quint16* dst, int width)
+{
+    for(int x = 0; x < width; ++x)
+        dst[4 * x + 3] = 65535;
+}
+
+/**
+ * @brief Set the alpha channel of a half float RGBA row to opaque (1.0).
+ */
+inline void fillRowAlphaRgba16F(quint16* dst, int width)
+{
+    for(int x = 0; x < width; ++x)
+        dst[4 * x + 3] = 0x3c00; // 1.0 in IEEE 754 binary16
+}
+
+/**
+ * @brief Set the alpha channel of a float RGBA row to opaque (1.0).
+ */
+inline void fillRowAlphaRgba32F(float* dst, int width)
+{
+    for(int x = 0; x < width; ++x)
+        dst[4 * x + 3] = 1.0f;
+}
+
+/**
+ * @brief Swizzle in place a row of RGBA bytes to 32-bit (A)RGB pixels (0xAARRGGBB).
+ * @param[in,out] row pixels, stored as R, G, B, A bytes on input
+ * @param[in] width number of pixels in the row
+ * @param[in] opaque if true, alpha is set to 0xff (for RGB inputs with an undefined 4th byte)
+ */
+inline void swizzleRowRgba8ToArgb32(quint32* row, int width, bool opaque)
+{
+    const quint32 alphaMask = opaque ? 0xff000000u : 0u;
+    for(int x = 0; x < width; ++x)
+    {
+        // 0xAABBGGRR whatever the platform endianness
+        const quint32 v = qFromLittleEndian(row[x]);
+        row[x] = (v & 0xff00ff00u) | ((v >> 16) & 0xffu) | ((v & 0xffu) << 16) | alphaMask;
+    }
+}
@@ -0,0 +1,226 @@
+#include "sequencePrefetcher.hpp"
+#include "QtOIIOHandler.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * @brief Decode of a neighboring frame, with the read options of the requested frame.
+ */
+class PrefetchJob : public QRunnable
+{
+public:
+    PrefetchJob(SequencePrefetcher& prefetcher, const QtOIIOCache::Key& key)
+        : prefetcher(prefetcher)
+        , key(key)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        QImage image;
+        QFile file(key.path);
+        if(file.open(QIODevice::ReadOnly))
+        {
+            QtOIIOHandler handler;
+            handler.setDevice(&file);
+            // no prefetch from the prefetch reads
+            handler._prefetchNeighbors = false;
+            // stored in the prefetch buffer, out of the decoded-image cache statistics
+            handler._useCache = false;
+            if(key.scaledSize.isValid())
+                handler.setOption(QImageIOHandler::ScaledSize, key.scaledSize);
+            if(key.clipRect.isValid())
+                handler.setOption(QImageIOHandler::ClipRect, key.clipRect);
+            if(key.scaledClipRect.isValid())
+                handler.setOption(QImageIOHandler::ScaledClipRect, key.scaledClipRect);
+            if(!handler.read(&image))
+                image = QImage();
+        }
+        prefetcher.finish(this, image);
+    }
+
+    SequencePrefetcher& prefetcher;
+    const QtOIIOCache::Key key;
+};
+
+namespace {
+
+const qint64 defaultPrefetchSizeMB = 256;
+
+int prefetchWindowFromEnv()
+{
+    const char* prefetchEnv = std::getenv("QTOIIO_PREFETCH");
+    // opt-in: any file with digits in its name would start background decodes in every application
+    return prefetchEnv ? std::max(0, std::atoi(prefetchEnv)) : 0;
+}
+
+qint64 prefetchSizeFromEnv()
+{
+    const char* prefetchSizeEnv = std::getenv("QTOIIO_PREFETCH_SIZE");
+    if(!prefetchSizeEnv)
+        return defaultPrefetchSizeMB * 1024 * 1024;
+    return std::max(0ll, std::atoll(prefetchSizeEnv)) * 1024 * 1024;
+}
+
+} // namespace
+
+SequencePrefetcher& SequencePrefetcher::instance()
+{
+    static SequencePrefetcher prefetcher;
+    return prefetcher;
+}
+
+SequencePrefetcher::SequencePrefetcher()
+    : _window(prefetchWindowFromEnv())
+    , _buffer(prefetchSizeFromEnv())
+{
+    // background decodes: the row conversions are already parallel, keep most cores for the requested frames
+    _pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 4));
+    qDebug() << "[QtOIIO] Sequence prefetch: window " << _window << ", " << _buffer.maxBytes() / (1024 * 1024) << " MB";
+}
+
+SequencePrefetcher::~SequencePrefetcher()
+{
+    {
+        QMutexLocker lock(&_mutex);
+        for(const auto& job : _jobs)
+        {
+            if(_pool.tryTake(job.second))
+                delete job.second;
+        }
+    }
+    _pool.waitForDone();
+}
+
+QStringList SequencePrefetcher::neighborFrames(const QString& filePath, int window)
+{
+    QStringList frames;
+    const QFileInfo fileInfo(filePath);
+    // prefix, frame number (last digits group), suffix
+    static const QRegularExpression framePattern("^(.*\\D)?(\\d+)(\\D*)$");
+    const QRegularExpressionMatch match = framePattern.match(fileInfo.fileName());
+    if(!match.hasMatch())
+        return frames;
+
+    const QString prefix = match.captured(1);
+    const QString digits = match.captured(2);
+    const QString suffix = match.captured(3);
+    bool ok = false;
+    const qlonglong frame = digits.toLongLong(&ok);
+    if(!ok)
+        return frames;
+
+    const QDir directory = fileInfo.dir();
+    for(int offset = 1; offset <= window; ++offset)
+    {
+        // next frame first: sequences are mostly stepped forward
+        for(const qlonglong neighbor : {frame + offset, frame - offset})
+        {
+            if(neighbor < 0)
+                continue;
+            const QString neighborPath = directory.filePath(prefix + QString("%1").arg(neighbor, digits.size(), 10, QChar('0')) + suffix);
+            if(QFileInfo::exists(neighborPath))
+                frames.append(neighborPath);
+        }
+    }
+    return frames;
+}
+
+void SequencePrefetcher::prefetch(const QtOIIOCache::Key& key)
+{
+    if(!enabled())
+        return;
+
+    std::vector<QtOIIOCache::Key> frameKeys;
+    for(const QString& frame : neighborFrames(key.path, _window))
+    {
+        // same key as a read of this frame: canonical path
+        const QFileInfo frameInfo(frame);
+        QtOIIOCache::Key frameKey = key;
+        frameKey.path = frameInfo.canonicalFilePath();
+        frameKey.lastModified = frameInfo.lastModified().toMSecsSinceEpoch();
+        if(!_buffer.contains(frameKey) && !QtOIIOCache::instance().contains(frameKey))
+            frameKeys.push_back(frameKey);
+    }
+
+    QMutexLocker lock(&_mutex);
+    // drop the queued decodes that left the window (running decodes are finished)
+    for(auto it = _jobs.begin(); it != _jobs.end();)
+    {
+        const bool inWindow = std::any_of(frameKeys.begin(), frameKeys.end(), [&](const QtOIIOCache::Key& frameKey) { return frameKey == it->first; });
+        if(!inWindow && _pool.tryTake(it->second))
+        {
+            delete it->second;
+            it = _jobs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    int priority = int(frameKeys.size());
+    for(const QtOIIOCache::Key& frameKey : frameKeys)
+    {
+        --priority; // nearest frames first
+        if(_jobs.count(frameKey) > 0)
+            continue;
+        PrefetchJob* job = new PrefetchJob(*this, frameKey);
+        _jobs.emplace(frameKey, job);
+        _pool.start(job, priority);
+    }
+}
+
+bool SequencePrefetcher::take(const QtOIIOCache::Key& key, QImage& image)
+{
+    if(!enabled())
+        return false;
+
+    QMutexLocker lock(&_mutex);
+    const auto it = _jobs.find(key);
+    if(it != _jobs.end())
+    {
+        PrefetchJob* job = it->second;
+        if(_pool.tryTake(job))
+        {
+            // not started yet: faster to decode it on the calling thread
+            _jobs.erase(it);
+            delete job;
+            return false;
+        }
+        qDebug() << "[QtOIIO] Sequence prefetch: wait for " << key.path;
+        while(_jobs.count(key) > 0)
+            _jobFinished.wait(&_mutex);
+    }
+    lock.unlock();
+
+    // kept in the buffer: stepping back to this frame is a hit too
+    const bool found = _buffer.find(key, image);
+    if(found)
+        qDebug() << "[QtOIIO] Sequence prefetch hit: " << key.path;
+    return found;
+}
+
+void SequencePrefetcher::finish(PrefetchJob* job, const QImage& image)
+{
+    if(!image.isNull())
+        _buffer.insert(job->key, image);
+
+    QMutexLocker lock(&_mutex);
+    _jobs.erase(job->key);
+    delete job;
+    _jobFinished.wakeAll();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "QtOIIOCache.hpp"
+
+#include <QImage>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <unordered_map>
+
+class PrefetchJob;
+
+/**
+ * @brief Background decode of the neighboring frames of numbered image sequences.
+ *
+ * When a frame of a sequence is read (e.g. "frame.0042.exr"), the next and previous frames
+ * are decoded in the background with the same read options (scaled size, clip rects, conversion),
+ * into a bounded buffer where the next reads find them.
+ * The window (number of frames on each side) is set by the QTOIIO_PREFETCH environment variable
+ * (default: 0, the prefetch is disabled), the memory budget of the buffer by QTOIIO_PREFETCH_SIZE (in MB).
+ */
+class SequencePrefetcher
+{
+public:
+    /// Process-wide instance
+    static SequencePrefetcher& instance();
+
+    bool enabled() const { return _window > 0 && _buffer.maxBytes() > 0; }
+
+    /**
+     * @brief Queue the decodes of the frames around a requested frame, nearest first.
+     *        Queued decodes outside of the new window are dropped.
+     * @param[in] key cache key of the requested frame (a file on disk)
+     */
+    void prefetch(const QtOIIOCache::Key& key);
+
+    /**
+     * @brief Get a prefetched frame. If its decode is running, wait for it.
+     *        If it is still queued, it is dropped: the caller decodes it itself.
+     * @return true if the frame was prefetched
+     */
+    bool take(const QtOIIOCache::Key& key, QImage& image);
+
+    /**
+     * @brief Get the existing files of the same numbered sequence around a file, nearest first.
+     *        The frame number is the last digits group of the file name, its zero padding is kept.
+     * @param[in] window maximum number of frames before and after the file
+     */
+    static QStringList neighborFrames(const QString& filePath, int window);
+
+private:
+    friend class PrefetchJob;
+
+    SequencePrefetcher();
+    ~SequencePrefetcher();
+
+    void finish(PrefetchJob* job, const QImage& image);
+
+    const int _window;
+    QtOIIOCache _buffer;
+    QThreadPool _pool;
+    QMutex _mutex;
+    QWaitCondition _jobFinished;
+    /// queued and running decodes, by frame and read options (the same frame can be prefetched at several sizes)
+    std::unordered_map<QtOIIOCache::Key, PrefetchJob*, QtOIIOCache::KeyHash> _jobs;
+};
@@ -0,0 +1,34 @@
+#include "threadBudget.hpp"
+
+#include <QDebug>
+
+#include <OpenImageIO/imageio.h>
+
+#include <cstdlib>
+#include <mutex>
+
+namespace oiio = OIIO;
+
+namespace {
+
+int getThreadsEnv()
+{
+    const char* threadsEnv = std::getenv("QTOIIO_THREADS");
+    return threadsEnv != nullptr ? std::max(0, std::atoi(threadsEnv)) : 0;
+}
+
+} // namespace
+
+void initThreadBudget()
+{
+    static std::once_flag initialized;
+    std::call_once(initialized, []() {
+        const int threads = getThreadsEnv();
+        if(threads <= 0)
+            return;
+        // a single pool for the decoders (OIIO, OpenEXR) and the row conversions
+        oiio::attribute("threads", threads);
+        oiio::attribute("exr_threads", threads);
+        qDebug() << "[QtOIIO] Thread budget: " << threads;
+    });
+}
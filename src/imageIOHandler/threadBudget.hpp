@@ -0,0 +1,57 @@
+#pragma once
+
+#include <OpenImageIO/parallel.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief Apply the thread budget of the plugin to OpenImageIO (once per process).
+ *
+ * When the QTOIIO_THREADS environment variable is set, it caps OIIO's shared thread pool
+ * ("threads" attribute) and the OpenEXR decoding threads ("exr_threads" attribute).
+ * Otherwise, OIIO's defaults (one thread per core) are kept.
+ */
+void initThreadBudget();
+
+/**
+ * @brief Run a function over blocks of rows of [0, height) on OIIO's shared thread pool.
+ * @param[in] blockRows number of rows of each block (the last block may be smaller)
+ * @param[in] f function called as f(ybegin, yend) for each block, blocks run concurrently
+ */
+template <typename BlockFunction>
+void parallelRowBlocks(int height, int blockRows, BlockFunction&& f)
+{
+    blockRows = std::max(blockRows, 1);
+    if(height <= blockRows)
+    {
+        f(0, height);
+        return;
+    }
+#if OIIO_VERSION >= (10000 * 2 + 100 * 3 + 0) // OIIO_VERSION >= 2.3.0
+    OIIO::parallel_for_chunked(0, height, blockRows, [&](std::int64_t ybegin, std::int64_t yend) {
+        f(int(ybegin), int(yend));
+    });
+#else
+    OIIO::parallel_for_chunked(0, height, blockRows, [&](int /*id*/, std::int64_t ybegin, std::int64_t yend) {
+        f(int(ybegin), int(yend));
+    });
+#endif
+}
+
+/**
+ * @brief Run a row function over [0, height) on OIIO's shared thread pool.
+ *
+ * Rows are split in chunks of about 64K pixels, each chunk is a task of the pool, so that
+ * concurrent reads share the same threads (and the same budget) instead of spawning their own.
+ * Small images are converted on the calling thread.
+ * @param[in] f function called as f(ybegin, yend) for each chunk of rows, it allocates its own
+ *            scratch buffers (chunks run concurrently)
+ */
+template <typename RowFunction>
+void parallelRows(int height, int width, RowFunction&& f)
+{
+    const std::int64_t chunkPixels = 1 << 16;
+    parallelRowBlocks(height, int(std::max<std::int64_t>(1, chunkPixels / std::max(width, 1))), f);
+}
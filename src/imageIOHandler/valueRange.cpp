@@ -0,0 +1,139 @@
+#include "valueRange.hpp"
+#include "threadBudget.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace oiio = OIIO;
+
+namespace {
+
+const int histogramBits = 16;
+const std::size_t histogramSize = std::size_t(1) << histogramBits;
+
+/// float bits mapped to unsigned integers with the same order as the float values
+std::uint32_t orderedBits(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+float fromOrderedBits(std::uint32_t ordered)
+{
+    const std::uint32_t bits = (ordered & 0x80000000u) ? (ordered & 0x7fffffffu) : ~ordered;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// center value of a histogram bin
+float binValue(std::size_t bin)
+{
+    return fromOrderedBits((std::uint32_t(bin) << (32 - histogramBits)) | (1u << (31 - histogramBits)));
+}
+
+} // namespace
+
+float ValueRange::lowPercentileFromEnv()
+{
+    const char* rangeEnv = std::getenv("QTOIIO_DEPTH_RANGE");
+    if(!rangeEnv)
+        return 0.0f;
+    const std::string mode(rangeEnv);
+    const std::string percentilePrefix = "percentile";
+    if(mode.compare(0, percentilePrefix.size(), percentilePrefix) != 0)
+        return 0.0f; // "minmax"
+    float lowPercentile = 1.0f;
+    if(mode.size() > percentilePrefix.size() + 1 && mode[percentilePrefix.size()] == ':')
+        lowPercentile = float(std::atof(mode.c_str() + percentilePrefix.size() + 1));
+    return std::min(std::max(lowPercentile, 0.0f), 49.9f);
+}
+
+bool ValueRange::compute(const oiio::ImageBuf& buf, float lowPercentile)
+{
+    const oiio::ROI roi = buf.roi();
+    const int width = roi.width();
+    const int height = roi.height();
+    const bool useHistogram = lowPercentile > 0.0f;
+
+    std::mutex mutex;
+    std::vector<std::uint64_t> histogram(useHistogram ? histogramSize : 0, 0);
+    std::uint64_t count = 0;
+    float minValue = std::numeric_limits<float>::max();
+    float maxValue = std::numeric_limits<float>::lowest();
+
+    // a few large blocks: each one fills its own histogram, merged once at the end of the block
+    const int blockRows = std::max(1, (height + 15) / 16);
+    parallelRowBlocks(height, blockRows, [&](int ybegin, int yend)
+    {
+        std::vector<float> row(width);
+        std::vector<std::uint32_t> blockHistogram(useHistogram ? histogramSize : 0, 0);
+        std::uint64_t blockCount = 0;
+        float blockMin = std::numeric_limits<float>::max();
+        float blockMax = std::numeric_limits<float>::lowest();
+        for(int y = ybegin; y < yend; ++y)
+        {
+            const oiio::ROI rowROI(roi.xbegin, roi.xend, roi.ybegin + y, roi.ybegin + y + 1, roi.zbegin, roi.zbegin + 1, roi.chbegin, roi.chbegin + 1);
+            buf.get_pixels(rowROI, oiio::TypeDesc::FLOAT, row.data());
+            for(int x = 0; x < width; ++x)
+            {
+                const float v = row[x];
+                if(!std::isfinite(v))
+                    continue;
+                blockMin = std::min(blockMin, v);
+                blockMax = std::max(blockMax, v);
+                ++blockCount;
+                if(useHistogram)
+                    ++blockHistogram[orderedBits(v) >> (32 - histogramBits)];
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        minValue = std::min(minValue, blockMin);
+        maxValue = std::max(maxValue, blockMax);
+        count += blockCount;
+        for(std::size_t i = 0; i < blockHistogram.size(); ++i)
+            histogram[i] += blockHistogram[i];
+    });
+
+    if(count == 0)
+    {
+        min = max = 0.0f;
+        return false;
+    }
+
+    min = minValue;
+    max = maxValue;
+    if(useHistogram)
+    {
+        // bins containing the low and high percentiles, clamped to the exact bounds
+        const std::uint64_t lowRank = std::uint64_t(double(count) * lowPercentile / 100.0);
+        const std::uint64_t highRank = count - 1 - lowRank;
+        std::uint64_t cumulated = 0;
+        bool lowFound = false;
+        for(std::size_t bin = 0; bin < histogramSize; ++bin)
+        {
+            cumulated += histogram[bin];
+            if(!lowFound && cumulated > lowRank)
+            {
+                min = std::max(minValue, binValue(bin));
+                lowFound = true;
+            }
+            if(cumulated > highRank)
+            {
+                max = std::min(maxValue, binValue(bin));
+                break;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <OpenImageIO/imagebuf.h>
+
+/**
+ * @brief Range of the values of a single channel image, mapped to [0, 1] for display (color maps).
+ *
+ * The range is computed in a single parallel pass over blocks of rows. In percentile mode,
+ * each block fills a histogram of the values (on the upper 16 bits of their ordered float
+ * representation, ~0.8% relative precision), so that a few outliers (e.g. far depths) do not squash
+ * the colors of the rest of the image.
+ * NaN and infinite values are ignored.
+ */
+struct ValueRange
+{
+    float min = 0.0f;
+    float max = 0.0f;
+
+    /**
+     * @brief Get the percentile used for the bounds from the QTOIIO_DEPTH_RANGE environment variable:
+     *        "minmax" (default) for the exact bounds, "percentile" for the 1st and 99th percentiles,
+     *        "percentile:P" for the P-th and (100-P)-th percentiles.
+     * @return the low percentile (in [0, 50[), 0 for the exact bounds
+     */
+    static float lowPercentileFromEnv();
+
+    /**
+     * @brief Compute the range of the first channel of an image.
+     * @param[in] lowPercentile percentage of the values clipped below the range (and above it),
+     *            0 for the exact minimum and maximum
+     * @return false if the image has no finite value
+     */
+    bool compute(const OIIO::ImageBuf& buf, float lowPercentile);
+};
@@ -0,0 +1,203 @@
+#include "OIIOImageProvider.hpp"
+
+#include <QDebug>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace oiioImageProvider {
+
+/**
+ * @brief Decode of an image, shared by the responses requesting the same path and size.
+ */
+class DecodeJob : public QRunnable
+{
+public:
+    DecodeJob(const QString& key, const QString& path, const QSize& requestedSize)
+        : key(key)
+        , path(path)
+        , requestedSize(requestedSize)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        DecodeScheduler& scheduler = DecodeScheduler::instance();
+        QString errorString;
+        const QImage image = DecodeScheduler::decode(path, requestedSize, errorString);
+        scheduler.finish(this, image, errorString);
+    }
+
+    const QString key;
+    const QString path;
+    const QSize requestedSize;
+    /// responses waiting for this decode, guarded by the scheduler mutex
+    QVector<ImageResponse*> responses;
+};
+
+namespace {
+
+int providerThreadsFromEnv()
+{
+    // by default, keep some cores for the UI and the other users of Qt's global pool
+    const int defaultThreads = std::max(1, QThread::idealThreadCount() / 2);
+    const char* threadsEnv = std::getenv("QTOIIO_PROVIDER_THREADS");
+    if(!threadsEnv)
+        return defaultThreads;
+    const int threads = std::atoi(threadsEnv);
+    return threads > 0 ? threads : defaultThreads;
+}
+
+QString requestKey(const QString& path, const QSize& requestedSize)
+{
+    return QString("%1@%2x%3").arg(path).arg(requestedSize.width()).arg(requestedSize.height());
+}
+
+} // namespace
+
+DecodeScheduler& DecodeScheduler::instance()
+{
+    static DecodeScheduler scheduler;
+    return scheduler;
+}
+
+DecodeScheduler::DecodeScheduler()
+{
+    _pool.setMaxThreadCount(providerThreadsFromEnv());
+    qDebug() << "[QtOIIO] Image provider decode threads: " << _pool.maxThreadCount();
+}
+
+void DecodeScheduler::request(ImageResponse* response, const QString& path, const QSize& requestedSize)
+{
+    const QString key = requestKey(path, requestedSize);
+
+    QMutexLocker lock(&_mutex);
+    DecodeJob* job = _jobs.value(key, nullptr);
+    if(job)
+    {
+        qDebug() << "[QtOIIO] Image provider: merge request for " << path;
+        job->responses.append(response);
+        response->_job = job;
+        return;
+    }
+
+    job = new DecodeJob(key, path, requestedSize);
+    job->responses.append(response);
+    response->_job = job;
+    _jobs.insert(key, job);
+    // most recent requests first
+    _pool.start(job, _nextPriority++);
+}
+
+bool DecodeScheduler::cancel(ImageResponse* response)
+{
+    QMutexLocker lock(&_mutex);
+    DecodeJob* job = response->_job;
+    if(!job)
+        return false; // already finished (or being finished by the decode thread)
+
+    response->_job = nullptr;
+    job->responses.removeOne(response);
+    if(job->responses.isEmpty() && _pool.tryTake(job))
+    {
+        // not started yet: drop the decode
+        qDebug() << "[QtOIIO] Image provider: cancel decode of " << job->path;
+        _jobs.remove(job->key);
+        delete job;
+    }
+    // else: the decode is running, its result will be dropped (or used by merged requests)
+    return true;
+}
+
+QImage DecodeScheduler::decode(const QString& path, const QSize& requestedSize, QString& errorString)
+{
+    QImageReader reader(path);
+    if(requestedSize.width() > 0 || requestedSize.height() > 0)
+    {
+        // fit in the requested size, keeping the aspect ratio and without upscaling
+        const QSize size = reader.size();
+        if(size.isValid())
+        {
+            QSize boundingSize(requestedSize.width() > 0 ? requestedSize.width() : size.width(),
+                               requestedSize.height() > 0 ? requestedSize.height() : size.height());
+            const QSize scaledSize = size.scaled(boundingSize, Qt::KeepAspectRatio);
+            if(scaledSize.width() < size.width() && !scaledSize.isEmpty())
+                reader.setScaledSize(scaledSize);
+        }
+    }
+
+    QImage image;
+    if(!reader.read(&image))
+        errorString = QString("Cannot read image %1: %2").arg(path, reader.errorString());
+    return image;
+}
+
+void DecodeScheduler::finish(DecodeJob* job, const QImage& image, const QString& errorString)
+{
+    QVector<ImageResponse*> responses;
+    {
+        QMutexLocker lock(&_mutex);
+        _jobs.remove(job->key);
+        responses.swap(job->responses);
+        for(ImageResponse* response : responses)
+            response->_job = nullptr;
+    }
+    if(responses.isEmpty())
+        qDebug() << "[QtOIIO] Image provider: drop decoded image of cancelled request " << job->path;
+
+    // delivered in the thread of each response, once the engine is listening to its finished signal
+    for(ImageResponse* response : responses)
+        QMetaObject::invokeMethod(response, [response, image, errorString]() { response->setResult(image, errorString); }, Qt::QueuedConnection);
+    delete job;
+}
+
+ImageResponse::ImageResponse(const QString& path, const QSize& requestedSize)
+{
+    DecodeScheduler::instance().request(this, path, requestedSize);
+}
+
+ImageResponse::~ImageResponse()
+{
+    // removed from its decode under the scheduler mutex (no-op if the decode has finished)
+    DecodeScheduler::instance().cancel(this);
+}
+
+QQuickTextureFactory* ImageResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(_image);
+}
+
+void ImageResponse::cancel()
+{
+    // a cancelled response still has to emit finished, unless the decode thread is already doing it
+    if(DecodeScheduler::instance().cancel(this))
+    {
+        _errorString = "Cancelled";
+        Q_EMIT finished();
+    }
+}
+
+void ImageResponse::setResult(const QImage& image, const QString& errorString)
+{
+    _image = image;
+    _errorString = errorString;
+    Q_EMIT finished();
+}
+
+QQuickImageResponse* OIIOImageProvider::requestImageResponse(const QString& id, const QSize& requestedSize)
+{
+    // id is the percent-encoded path (or file url) following "image://oiio/"
+    QString path = QUrl::fromPercentEncoding(id.toUtf8());
+    if(path.startsWith("file:"))
+        path = QUrl(path).toLocalFile();
+    return new ImageResponse(path, requestedSize);
+}
+
+}
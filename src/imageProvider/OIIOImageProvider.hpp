@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QtQuick/QQuickAsyncImageProvider>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+namespace oiioImageProvider {
+
+class DecodeJob;
+class ImageResponse;
+
+/**
+ * @brief Decode pool shared by all the image provider requests.
+ *
+ * Images are decoded with QImageReader (and so through the QtOIIO image plugin) on a dedicated
+ * thread pool, separated from Qt's global pool. Requests for the same path and size are merged
+ * into a single decode. The most recent requests are decoded first: when scrolling a view,
+ * they correspond to the visible delegates, while the requests of the delegates that have been
+ * destroyed in the meantime are cancelled and removed from the queue.
+ * The number of decode threads is set by the QTOIIO_PROVIDER_THREADS environment variable.
+ */
+class DecodeScheduler
+{
+public:
+    static DecodeScheduler& instance();
+
+    /// Queue the decode of an image for a response (or attach it to the pending decode of the same image)
+    void request(ImageResponse* response, const QString& path, const QSize& requestedSize);
+
+    /**
+     * @brief Detach a response from its decode, the decode is dropped if it has no other response.
+     * @return true if the response was still waiting for its image
+     */
+    bool cancel(ImageResponse* response);
+
+private:
+    friend class DecodeJob;
+
+    DecodeScheduler();
+
+    /// decode an image, scaled to fit in the requested size (if valid)
+    static QImage decode(const QString& path, const QSize& requestedSize, QString& errorString);
+    void finish(DecodeJob* job, const QImage& image, const QString& errorString);
+
+    QThreadPool _pool;
+    QMutex _mutex;
+    /// pending decodes, by path and requested size
+    QHash<QString, DecodeJob*> _jobs;
+    int _nextPriority = 0;
+};
+
+/**
+ * @brief Response to an image request, finished when its decode is done or when it is cancelled.
+ */
+class ImageResponse : public QQuickImageResponse
+{
+public:
+    ImageResponse(const QString& path, const QSize& requestedSize);
+    /// Detach from the pending decode, which must not deliver its result to a deleted response
+    ~ImageResponse() override;
+
+    QQuickTextureFactory* textureFactory() const override;
+    QString errorString() const override { return _errorString; }
+    void cancel() override;
+
+private:
+    friend class DecodeScheduler;
+
+    void setResult(const QImage& image, const QString& errorString);
+
+    QImage _image;
+    QString _errorString;
+    /// pending decode, guarded by the scheduler mutex
+    DecodeJob* _job = nullptr;
+};
+
+/**
+ * @brief Asynchronous image provider decoding images through OpenImageIO.
+ *
+ * Usage in QML, once the provider has been added to the engine (as "oiio"):
+ *     Image { source: "image://oiio/" + filepath; sourceSize: Qt.size(256, 256); asynchronous: true }
+ */
+class OIIOImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
+};
+
+}
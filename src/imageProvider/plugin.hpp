@@ -0,0 +1,27 @@
+#pragma once
+
+#include "OIIOImageProvider.hpp"
+
+#include <QtQml/QtQml>
+#include <QtQml/QQmlExtensionPlugin>
+
+namespace oiioImageProvider {
+
+class OIIOImageProviderQmlPlugin : public QQmlExtensionPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "oiioImageProvider.qmlPlugin")
+
+public:
+    void initializeEngine(QQmlEngine* engine, const char* uri) override
+    {
+        engine->addImageProvider("oiio", new OIIOImageProvider);
+    }
+    void registerTypes(const char* uri) override
+    {
+        Q_ASSERT(uri == QLatin1String("OIIOImageProvider"));
+        qmlRegisterModule(uri, 1, 0);
+    }
+};
+
+}
@@ -65,8 +65,8 @@ inline Color32f getColor32fFromJetColorMapClamp(float value)
         return Color32f(1.0f, 0.0f, 1.0f);
     if(value < 0.0f)
         value = 0.0f;
-    if(value > 1.0f)
-        value = 1.0f;
+    if(value >= 1.0f)
+        return Color32f(jetr[63], jetg[63], jetb[63]); // no interpolation with the (missing) next entry
     float idx_f = value * 63.0f;
     float fractA, fractB, integral;
     fractB = std::modf(idx_f, &integral);
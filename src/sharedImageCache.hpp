@@ -0,0 +1,77 @@
+#pragma once
+
+#include <OpenImageIO/imagecache.h>
+
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Get the process-wide OIIO ImageCache used to read images, if enabled.
+ *
+ * The cache is opt-in (QTOIIO_IMAGECACHE=1). Images are then read through OIIO's shared
+ * ImageCache: tiled files are paged at tile granularity and the memory is shared between
+ * all the readers of the process (image plugin, depth map entity).
+ * The cache is configured with:
+ *  - QTOIIO_IMAGECACHE_MAX_MEMORY: maximum memory used by the cache (in MB)
+ *  - QTOIIO_IMAGECACHE_MAX_OPEN_FILES: maximum number of files kept open
+ *
+ * @return the shared ImageCache or nullptr if disabled
+ */
+inline OIIO::ImageCache* getSharedImageCache()
+{
+    static OIIO::ImageCache* imageCache = []() -> OIIO::ImageCache* {
+        const char* imageCacheEnv = std::getenv("QTOIIO_IMAGECACHE");
+        if(!imageCacheEnv || std::string(imageCacheEnv) != "1")
+            return nullptr;
+
+        // shared instance: the same cache is returned to every module of the process
+        OIIO::ImageCache* cache = OIIO::ImageCache::create(true);
+        if(const char* maxMemoryEnv = std::getenv("QTOIIO_IMAGECACHE_MAX_MEMORY"))
+            cache->attribute("max_memory_MB", static_cast<float>(std::atof(maxMemoryEnv)));
+        if(const char* maxOpenFilesEnv = std::getenv("QTOIIO_IMAGECACHE_MAX_OPEN_FILES"))
+            cache->attribute("max_open_files", std::atoi(maxOpenFilesEnv));
+        return cache;
+    }();
+    return imageCache;
+}
+
+/**
+ * @brief Get the statistics of the shared ImageCache (memory, tiles, files, hit rates...).
+ * @return the statistics report, empty if the shared ImageCache is disabled
+ */
+inline std::string getSharedImageCacheStats(int level = 1)
+{
+    OIIO::ImageCache* cache = getSharedImageCache();
+    return cache ? cache->getstats(level) : std::string();
+}
+
+/**
+ * @brief Invalidate the shared ImageCache entries of a file if it has been modified since the last call.
+ *        The ImageCache does not check the files again once opened: a rewritten file would be read
+ *        from the stale tiles.
+ * @param[in] path file path, as given to the ImageCache
+ * @param[in] lastModified modification time of the file (in any unit, compared with the previous call)
+ */
+inline void invalidateSharedImageCacheIfModified(const std::string& path, long long lastModified)
+{
+    OIIO::ImageCache* cache = getSharedImageCache();
+    if(!cache)
+        return;
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, long long> lastModifiedTimes;
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = lastModifiedTimes.find(path);
+    if(it == lastModifiedTimes.end())
+    {
+        lastModifiedTimes.emplace(path, lastModified);
+        return;
+    }
+    if(it->second != lastModified)
+    {
+        cache->invalidate(OIIO::ustring(path));
+        it->second = lastModified;
+    }
+}